@@ -0,0 +1,67 @@
+#include "AllocCounter.h"
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions of the plugin module so every
+// allocation bumps a per thread counter. The cost is a single TLS increment.
+namespace {
+thread_local size_t t_allocations = 0;
+}
+
+size_t ThreadAllocationCount() {
+  return t_allocations;
+}
+
+void* operator new(std::size_t size) {
+  ++t_allocations;
+  if (size == 0)
+    size = 1;
+  for (;;) {
+    if (void* p = std::malloc(size))
+      return p;
+    std::new_handler handler = std::get_new_handler();
+    if (!handler)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+
+void* operator new[](std::size_t size) {
+  return ::operator new(size);
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept {
+  try {
+    return ::operator new(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept {
+  return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::nothrow_t const&) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, std::nothrow_t const&) noexcept {
+  std::free(p);
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <cstddef>
+
+// Number of heap allocations made through global operator new on the calling
+// thread. Used to check that hot paths stay allocation free.
+size_t ThreadAllocationCount();
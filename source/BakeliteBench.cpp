@@ -0,0 +1,380 @@
+// Microbenchmarks of the event path and of the GfeSDK wrapper's per call work,
+// reporting ns/op and heap allocations/op. Use --json to keep results for
+// comparing commits. Also checks that ConfigureHighlights frees everything on
+// success and failure and that batched video highlights all complete, and
+// exits with 1 if either check fails. The session benchmarks run one wrapper
+// session per thread to show sessions do not contend.
+//
+// Usage: bakelite_bench [iterations] [--json]
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AllocCounter.h"
+#include "Bench.h"
+#include "FakeGfeSdk.h"
+#include "HighlightCore.h"
+#include "Log.h"
+#include "SdkBatch.h"
+
+#if defined(__GLIBC__)
+// The wrapper allocates with malloc/calloc, which operator new counting misses.
+// glibc lets the executable interpose them and forward to the real allocator.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void __libc_free(void* p);
+}
+
+namespace {
+thread_local size_t t_heapAllocations = 0;
+thread_local size_t t_heapFrees = 0;
+}
+
+extern "C" void* malloc(size_t size) {
+  ++t_heapAllocations;
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+  ++t_heapAllocations;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+  ++t_heapAllocations;
+  return __libc_realloc(p, size);
+}
+
+extern "C" void free(void* p) {
+  if (p)
+    ++t_heapFrees;
+  __libc_free(p);
+}
+
+static size_t HeapAllocationCount() {
+  return t_heapAllocations;
+}
+
+// Blocks allocated and not freed yet by the calling thread. Reallocations
+// count as an allocation only, so only meaningful for code that does not
+// realloc.
+static bool LiveHeapBlocks(long long& blocks) {
+  blocks = static_cast<long long>(t_heapAllocations) -
+           static_cast<long long>(t_heapFrees);
+  return true;
+}
+#else
+// Only C++ allocations are seen, the wrapper's calloc calls are not counted
+static size_t HeapAllocationCount() {
+  return ThreadAllocationCount();
+}
+
+static bool LiveHeapBlocks(long long&) {
+  return false;
+}
+#endif
+
+namespace {
+
+std::string ResolveNothing(uintptr_t) {
+  return std::string();
+}
+
+NVGSDK_RetCode g_immediateResult = NVGSDK_SUCCESS;
+
+// Complete the request before returning, so each op includes the callback
+// freeing what the call allocated
+void NVGSDKApi ImmediateConfigure(NVGSDK_HANDLE*,
+                                  NVGSDK_HighlightConfigParams const*,
+                                  NVGSDK_EmptyCallback callback,
+                                  void* context) {
+  callback(g_immediateResult, context);
+}
+
+// A successful Configure asks for the user settings
+void NVGSDKApi ImmediateGetUserSettings(
+    NVGSDK_HANDLE*,
+    NVGSDK_Highlights_GetUserSettingsCallback callback,
+    void* context) {
+  NVGSDK_Highlights_UserSettings settings = {nullptr, 0};
+  callback(NVGSDK_SUCCESS, &settings, context);
+}
+
+void NVGSDKApi ImmediateSaveVideo(NVGSDK_HANDLE*,
+                                  NVGSDK_VideoHighlightParams const*,
+                                  NVGSDK_EmptyCallback callback,
+                                  void* context) {
+  callback(NVGSDK_SUCCESS, context);
+}
+
+void NVGSDKApi ImmediateOpenSummary(NVGSDK_HANDLE*,
+                                    NVGSDK_SummaryParams const*,
+                                    NVGSDK_EmptyCallback callback,
+                                    void* context) {
+  callback(NVGSDK_SUCCESS, context);
+}
+
+// configure_copy        ConfigureHighlights deep copy of the plugin's table
+// configure_copy_named  same with a localized name per highlight
+// open_summary          OnOpenSummary parameter allocation for one group
+// save_video            OnSaveVideo, one request per clip
+// save_video_batch      OnSaveVideoBatch of 8 clips, per clip
+// Returns the number of heap blocks leaked by ConfigureHighlights
+long long RunWrapperBenchmarks(EventTable const& events, int iterations,
+                               std::vector<BenchResult>& results) {
+  long long leaks = 0;
+  std::vector<NVGSDK_Highlight> highlights;
+  BuildHighlightTable(events, highlights);
+
+  FakeGfeSdkOptions options;
+  options.latency = std::chrono::milliseconds(0);
+  FakeGfeSdkInstall(options);
+  GfeSdkWrapper sdk;
+  InitGfeSdkWrapper(&sdk);
+  GfeSdkSession* session =
+      sdk.Init("Rocket League", "en-US", highlights.data(), highlights.size(), "", 0);
+  sdk.OnTick(session);
+  NVGSDK_Highlights_ConfigureAsyncfn configure = NVGSDK_Highlights_ConfigureAsync;
+  NVGSDK_Highlights_OpenSummaryAsyncfn openSummary = NVGSDK_Highlights_OpenSummaryAsync;
+  NVGSDK_Highlights_SetVideoHighlightAsyncfn saveVideo =
+      NVGSDK_Highlights_SetVideoHighlightAsync;
+  NVGSDK_Highlights_GetUserSettingsAsyncfn getUserSettings =
+      NVGSDK_Highlights_GetUserSettingsAsync;
+  NVGSDK_Highlights_ConfigureAsync = &ImmediateConfigure;
+  NVGSDK_Highlights_GetUserSettingsAsync = &ImmediateGetUserSettings;
+  NVGSDK_Highlights_OpenSummaryAsync = &ImmediateOpenSummary;
+  NVGSDK_Highlights_SetVideoHighlightAsync = &ImmediateSaveVideo;
+
+  results.push_back(RunBench("configure_copy", iterations, &HeapAllocationCount, [&](int) {
+    sdk.ConfigureHighlights(session, "en-US", highlights.data(), highlights.size());
+  }));
+
+  std::vector<NVGSDK_LocalizedPair> names(highlights.size());
+  std::vector<NVGSDK_Highlight> named = highlights;
+  for (size_t i = 0; i < named.size(); ++i) {
+    names[i].localeCode = "en-US";
+    names[i].localizedString = named[i].id;
+    named[i].nameTable = &names[i];
+    named[i].nameTableSize = 1;
+  }
+  results.push_back(RunBench("configure_copy_named", iterations, &HeapAllocationCount, [&](int) {
+    sdk.ConfigureHighlights(session, "en-US", named.data(), named.size());
+  }));
+
+  // Everything ConfigureHighlights allocates must be released by its
+  // callback, whether the SDK accepted the table or not
+  for (NVGSDK_RetCode result : {NVGSDK_SUCCESS, NVGSDK_ERR_GENERIC}) {
+    g_immediateResult = result;
+    long long before, after;
+    if (!LiveHeapBlocks(before)) {
+      std::fprintf(stderr, "configure leak check: skipped, heap not tracked\n");
+      break;
+    }
+    for (int i = 0; i < 100; ++i)
+      sdk.ConfigureHighlights(session, "en-US", named.data(), named.size());
+    LiveHeapBlocks(after);
+    std::fprintf(stderr, "configure leak check (%s): %s, %lld blocks left\n",
+                 NVGSDK_RetCodeToString(result), after == before ? "PASS" : "FAIL",
+                 after - before);
+    leaks += after - before;
+  }
+  g_immediateResult = NVGSDK_SUCCESS;
+
+  char const* groupIds[] = {GROUP1_ID};
+  results.push_back(RunBench("open_summary", iterations, &HeapAllocationCount, [&](int) {
+    sdk.OnOpenSummary(session, groupIds, 1, NVGSDK_HIGHLIGHT_SIGNIFICANCE_NONE,
+                      NVGSDK_HIGHLIGHT_TYPE_NONE);
+  }));
+
+  results.push_back(RunBench("save_video", iterations, &HeapAllocationCount, [&](int i) {
+    sdk.OnSaveVideo(session, highlights[i % highlights.size()].id, GROUP1_ID, -5000, 2000);
+  }));
+
+  constexpr size_t kBatch = 8;
+  GfeSdkVideoHighlight videos[kBatch];
+  for (size_t i = 0; i < kBatch; ++i)
+    videos[i] = {highlights[i % highlights.size()].id, GROUP1_ID, -5000, 2000};
+  BenchResult batched = RunBench("save_video_batch", iterations / kBatch,
+                                 &HeapAllocationCount, [&](int) {
+    SdkBatchRelease(sdk.OnSaveVideoBatch(session, videos, kBatch));
+  });
+  batched.ops *= kBatch;
+  batched.nsPerOp /= kBatch;
+  batched.allocsPerOp /= kBatch;
+  results.push_back(batched);
+
+  NVGSDK_Highlights_ConfigureAsync = configure;
+  NVGSDK_Highlights_OpenSummaryAsync = openSummary;
+  NVGSDK_Highlights_SetVideoHighlightAsync = saveVideo;
+  NVGSDK_Highlights_GetUserSettingsAsync = getUserSettings;
+  sdk.DeInit(session);
+  sdk.DestroySession(session);
+  return leaks;
+}
+
+// Submits batches against the fake with failures injected while another
+// thread waits on them, and checks every item is accounted for. Returns the
+// number of mismatches.
+int CheckVideoBatches(EventTable const& events) {
+  std::vector<NVGSDK_Highlight> highlights;
+  BuildHighlightTable(events, highlights);
+  FakeGfeSdkOptions options;
+  options.latency = std::chrono::milliseconds(1);
+  options.errorRate = 0.25;
+  options.recordCalls = false;
+  FakeGfeSdkInstall(options);
+  GfeSdkWrapper sdk;
+  InitGfeSdkWrapper(&sdk);
+  GfeSdkSession* session =
+      sdk.Init("Rocket League", "en-US", highlights.data(), highlights.size(), "", 0);
+
+  constexpr size_t kBatch = 12;
+  GfeSdkVideoHighlight videos[kBatch];
+  for (size_t i = 0; i < kBatch; ++i)
+    videos[i] = {highlights[i % highlights.size()].id, GROUP1_ID, -5000, 2000};
+  std::vector<SdkBatch*> batches;
+  for (int i = 0; i < 20; ++i)
+    batches.push_back(sdk.OnSaveVideoBatch(session, videos, kBatch));
+
+  // Callbacks run on the polling thread, the waiting happens here
+  std::atomic<bool> polling{true};
+  std::thread poller([&]() {
+    while (polling.load()) {
+      sdk.OnTick(session);
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  });
+  int mismatches = 0;
+  size_t failed = 0;
+  for (SdkBatch* batch : batches) {
+    if (!SdkBatchWait(batch, 5000)) {
+      ++mismatches;
+      continue;
+    }
+    size_t itemFailures = 0;
+    for (size_t i = 0; i < SdkBatchSize(batch); ++i)
+      itemFailures += SdkBatchResult(batch, i) < 0;
+    if (itemFailures != SdkBatchFailed(batch))
+      ++mismatches;
+    failed += itemFailures;
+  }
+  polling.store(false);
+  poller.join();
+  // Never polled, so left to DeInit, which must finish it
+  SdkBatch* abandoned = sdk.OnSaveVideoBatch(session, videos, kBatch);
+  SdkCallStats calls = GetSdkCallStats(GfeSdkSessionRequests(session), SDK_CALL_SAVE_VIDEO);
+  sdk.DeInit(session);
+  if (!SdkBatchDone(abandoned) || SdkBatchFailed(abandoned) != kBatch)
+    ++mismatches;
+  for (SdkBatch* batch : batches)
+    SdkBatchRelease(batch);
+  SdkBatchRelease(abandoned);
+  sdk.DestroySession(session);
+
+  // Everything but the abandoned batch came back through the SDK
+  if (calls.submitted != 21 * kBatch || calls.failed < failed)
+    ++mismatches;
+  std::fprintf(stderr, "video batch check: %s, %zu of %zu items failed\n",
+               mismatches == 0 ? "PASS" : "FAIL", failed, batches.size() * kBatch);
+  return mismatches;
+}
+
+// A video highlight plus the poll delivering its callback, on `threads`
+// sessions at once, each on its own thread. ns/op is wall time per op across
+// all threads, so it drops as sessions scale.
+BenchResult RunSessionBench(char const* name, EventTable const& events,
+                            int threads, int iterations) {
+  std::vector<NVGSDK_Highlight> highlights;
+  BuildHighlightTable(events, highlights);
+  FakeGfeSdkOptions options;
+  options.latency = std::chrono::milliseconds(0);
+  options.recordCalls = false;
+  FakeGfeSdkInstall(options);
+  GfeSdkWrapper sdk;
+  InitGfeSdkWrapper(&sdk);
+
+  std::vector<size_t> allocations(threads);
+  std::atomic<int> ready{0};
+  std::atomic<bool> go{false};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      GfeSdkSession* session = sdk.Init("Rocket League", "en-US", highlights.data(),
+                                        highlights.size(), "", 0);
+      sdk.OnTick(session);
+      ready.fetch_add(1);
+      while (!go.load())
+        std::this_thread::yield();
+      size_t before = HeapAllocationCount();
+      for (int i = 0; i < iterations; ++i) {
+        sdk.OnSaveVideo(session, highlights[i % highlights.size()].id, GROUP1_ID,
+                        -5000, 2000);
+        sdk.OnTick(session);
+      }
+      allocations[t] = HeapAllocationCount() - before;
+      sdk.DeInit(session);
+      sdk.DestroySession(session);
+    });
+  }
+  while (ready.load() < threads)
+    std::this_thread::yield();
+  auto start = std::chrono::steady_clock::now();
+  go.store(true);
+  for (std::thread& worker : workers)
+    worker.join();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  size_t made = 0;
+  for (size_t count : allocations)
+    made += count;
+  uint64_t ops = static_cast<uint64_t>(iterations) * threads;
+  return {name, ops, std::chrono::duration<double, std::nano>(elapsed).count() / ops,
+          static_cast<double>(made) / ops};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = 100000;
+  bool json = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--json") == 0)
+      json = true;
+    else
+      iterations = std::atoi(argv[i]);
+  }
+  if (iterations <= 0) {
+    std::fprintf(stderr, "Usage: bakelite_bench [iterations] [--json]\n");
+    return 2;
+  }
+
+  LogSetLevel(BL_LOG_ERROR);
+  LogStart();
+  HighlightCore core(&ResolveNothing);
+  core.LoadConfig();
+
+  std::vector<BenchResult> results =
+      RunCoreBenchmarks(core.Events(), iterations, &HeapAllocationCount);
+  long long leaks = RunWrapperBenchmarks(core.Events(), iterations, results);
+  int batchMismatches = CheckVideoBatches(core.Events());
+  int threads = static_cast<int>(std::thread::hardware_concurrency());
+  threads = threads < 2 ? 2 : threads > 4 ? 4 : threads;
+  results.push_back(RunSessionBench("sessions_single", core.Events(), 1, iterations));
+  results.push_back(RunSessionBench("sessions_parallel", core.Events(), threads, iterations));
+
+  if (json) {
+    std::printf("%s\n", BenchResultsToJson(results).c_str());
+  }
+  else {
+    for (BenchResult const& result : results)
+      std::printf("%s\n", FormatBenchResult(result).c_str());
+  }
+  LogStop();
+  return leaks == 0 && batchMismatches == 0 ? 0 : 1;
+}
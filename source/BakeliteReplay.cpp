@@ -0,0 +1,222 @@
+// Replays a capture recorded with bakelite_capture into HighlightCore running
+// against FakeGfeSdk, and reports how fast the events were processed.
+//
+// Usage: bakelite_replay <capture file> [speed|max] [callback latency ms]
+//
+// Rate limits see the recorded timestamps at any speed. The SDK worker and
+// its clip coalescing run on the wall clock, so above 1x fewer clips merge than
+// in the real match.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "EventCapture.h"
+#include "FakeGfeSdk.h"
+#include "HighlightCore.h"
+#include "Log.h"
+
+namespace {
+
+using Clock = RateLimiter::Clock;
+
+struct ReplayObject {
+  std::string name;
+};
+
+Clock::time_point g_replayNow;
+
+Clock::time_point ReplayClock() {
+  return g_replayNow;
+}
+
+std::string ResolveReplayName(uintptr_t statEvent) {
+  return reinterpret_cast<ReplayObject const*>(statEvent)->name;
+}
+
+// Team of each PRI id as recorded so far, PRIs are replayed as id + 1
+std::vector<int> g_replayTeams;
+
+int ResolveReplayTeam(uintptr_t pri) {
+  return pri - 1 < g_replayTeams.size() ? g_replayTeams[pri - 1] : -1;
+}
+
+size_t PeakMemoryKb() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return 0;
+  return counters.PeakWorkingSetSize / 1024;
+#else
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<size_t>(usage.ru_maxrss);
+#endif
+}
+
+uint32_t Percentile(std::vector<uint32_t> const& sorted, double percentile) {
+  if (sorted.empty())
+    return 0;
+  size_t rank = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+  return sorted[rank];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: bakelite_replay <capture file> [speed|max] [callback latency ms]\n");
+    return 2;
+  }
+  double speed = 0.0;
+  if (argc > 2 && std::strcmp(argv[2], "max") != 0)
+    speed = std::atof(argv[2]);
+
+  CaptureReader reader;
+  if (!reader.Open(argv[1])) {
+    std::fprintf(stderr, "%s is not a bakelite capture\n", argv[1]);
+    return 1;
+  }
+  std::vector<CaptureRecord> records;
+  uint32_t numObjects = 0;
+  CaptureRecord record;
+  while (reader.Next(record)) {
+    if (record.type == CaptureType::Object)
+      numObjects = std::max(numObjects, record.objectId + 1);
+    records.push_back(record);
+  }
+  // Sized up front: the core keys its cache on the object addresses
+  std::vector<ReplayObject> objects(numObjects);
+
+  FakeGfeSdkOptions options;
+  options.latency = std::chrono::milliseconds(argc > 3 ? std::atoi(argv[3]) : 20);
+  LogSetLevel(BL_LOG_ERROR);
+  LogStart();
+  FakeGfeSdkInstall(options);
+
+  // Same settings as the plugin's cvar defaults
+  HighlightCore core(&ResolveReplayName);
+  core.LoadConfig();
+  core.SetClock(&ReplayClock);
+  core.SetTeamResolver(&ResolveReplayTeam);
+  core.SetEventDelay(3.0);
+  core.SetGlobalLimit(RateLimit{2.0, 4.0});
+  core.SetCoalesceWindow(std::chrono::milliseconds(2000));
+  g_replayNow = Clock::now();
+  Clock::time_point replayStart = g_replayNow;
+  core.Start("", 0);
+
+  std::vector<uint32_t> latencies;
+  latencies.reserve(records.size());
+  Clock::time_point wallStart = Clock::now();
+  for (CaptureRecord const& next : records) {
+    auto offset = std::chrono::microseconds(next.timeUs);
+    if (speed > 0.0) {
+      std::this_thread::sleep_until(
+          wallStart + std::chrono::duration_cast<Clock::duration>(offset / speed));
+    }
+    g_replayNow = replayStart + offset;
+    switch (next.type) {
+      case CaptureType::Object:
+        objects[next.objectId].name = std::string(next.name);
+        break;
+      case CaptureType::StatEvent: {
+        if (next.objectId >= objects.size())
+          break;
+        uintptr_t statEvent = reinterpret_cast<uintptr_t>(&objects[next.objectId]);
+        Clock::time_point start = Clock::now();
+        core.HandleStatEvent(statEvent, next.priId + 1);
+        latencies.push_back(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start)
+                .count()));
+        break;
+      }
+      case CaptureType::HotKey:
+        core.OnHotKey(next.key);
+        break;
+      case CaptureType::MatchEnter:
+        core.OnMatchEnter(false);
+        break;
+      case CaptureType::MatchExit:
+        core.OnMatchExit(false);
+        break;
+      case CaptureType::GameClock:
+        core.SetGameClock(next.secondsRemaining, next.overtime);
+        break;
+      case CaptureType::ScoreMargin:
+        if (next.scoreKnown)
+          core.SetScoreMargin(next.scoreMargin);
+        else
+          core.ClearScoreMargin();
+        break;
+      case CaptureType::LocalPlayer:
+        core.SetLocalPlayer(next.hasPlayer ? next.priId + 1 : 0);
+        break;
+      case CaptureType::PlayerTeam:
+        if (next.priId >= g_replayTeams.size())
+          g_replayTeams.resize(next.priId + 1, -1);
+        g_replayTeams[next.priId] = next.team;
+        break;
+    }
+  }
+  double wallSeconds =
+      std::chrono::duration<double>(Clock::now() - wallStart).count();
+
+  for (int wait = 0; wait < 500; wait++) {
+    if (core.WorkerStats().depth == 0 && core.InFlight() == 0 &&
+        FakeGfeSdkGetCounters().pending == 0)
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  core.Stop();
+
+  std::vector<uint32_t> sorted = latencies;
+  std::sort(sorted.begin(), sorted.end());
+  double busyNs = 0;
+  for (uint32_t ns : latencies)
+    busyNs += ns;
+  std::printf("capture: %zu records, %zu stat events, %u objects, %.1fs recorded, %zu bytes\n",
+              records.size(), latencies.size(), numObjects,
+              records.empty() ? 0.0 : records.back().timeUs / 1e6, reader.Bytes());
+  std::printf("replay: %s speed, %.3fs wall, %.0f events/s wall, %.0f events/s processing\n",
+              speed > 0.0 ? argv[2] : "max", wallSeconds,
+              wallSeconds > 0 ? latencies.size() / wallSeconds : 0.0,
+              busyNs > 0 ? latencies.size() / (busyNs / 1e9) : 0.0);
+  std::printf("per event: p50 %uns, p99 %uns, max %uns\n", Percentile(sorted, 50),
+              Percentile(sorted, 99), sorted.empty() ? 0 : sorted.back());
+
+  SdkWorkerStats worker = core.WorkerStats();
+  RateLimiterStats limits = core.Limiter().Stats();
+  std::printf("admission: %llu admitted, %llu throttled per event, %llu throttled global\n",
+              (unsigned long long)limits.admitted,
+              (unsigned long long)limits.throttledEvent,
+              (unsigned long long)limits.throttledGlobal);
+  std::printf("worker: %llu commands, %llu dropped, clips %llu -> %llu\n",
+              (unsigned long long)worker.enqueued,
+              (unsigned long long)worker.dropped,
+              (unsigned long long)worker.clips.requests,
+              (unsigned long long)worker.clips.clips);
+  size_t calls[SDK_CALL_COUNT] = {};
+  for (FakeGfeSdkCall const& call : FakeGfeSdkCalls())
+    calls[call.type]++;
+  for (int type = 0; type < SDK_CALL_COUNT; type++) {
+    if (calls[type] > 0)
+      std::printf("sdk %s: %zu\n", SdkCallTypeName(static_cast<SdkCallType>(type)),
+                  calls[type]);
+  }
+  std::printf("peak memory: %zu KB\n", PeakMemoryKb());
+
+  LogStop();
+  return 0;
+}
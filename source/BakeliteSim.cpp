@@ -0,0 +1,336 @@
+// Drives HighlightCore against FakeGfeSdk: a synthetic match without the game,
+// BakkesMod or GFE, so the event and SDK paths can be run and profiled on any
+// platform.
+//
+// Usage: bakelite_sim [plays] [callback latency ms] [error %] [capture file]
+//
+// With a capture file the match is also recorded for bakelite_replay.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include "FakeGfeSdk.h"
+#include "HighlightCore.h"
+#include "Log.h"
+
+namespace {
+
+// Stands in for the game's StatEvent objects, one per event type
+struct SimStatEvent {
+  char const* name;
+};
+
+SimStatEvent const kShot = {"Shot"};
+SimStatEvent const kGoal = {"Goal"};
+SimStatEvent const kAssist = {"Assist"};
+SimStatEvent const kHighFive = {"HighFive"};
+SimStatEvent const kSave = {"Save"};
+SimStatEvent const kDemolish = {"Demolish"};
+SimStatEvent const kUnknown = {"TeamBonus"};
+
+std::string ResolveSimEventName(uintptr_t statEvent) {
+  return reinterpret_cast<SimStatEvent const*>(statEvent)->name;
+}
+
+uintptr_t Event(SimStatEvent const& event) {
+  return reinterpret_cast<uintptr_t>(&event);
+}
+
+// PRIs of a striker and the teammate passing to them. The core only uses PRIs
+// as keys, so any distinct non-zero values do.
+constexpr uintptr_t kStriker = 1;
+constexpr uintptr_t kPasser = 2;
+
+// Stat file format version of a plugin newer than this one
+constexpr int kNewerStatFormat = 2;
+
+char const* RetCodeName(int rc) {
+  return NVGSDK_RetCodeToString(static_cast<NVGSDK_RetCode>(rc));
+}
+
+void Sleep(int ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int plays = argc > 1 ? std::atoi(argv[1]) : 20;
+  FakeGfeSdkOptions options;
+  options.latency = std::chrono::milliseconds(argc > 2 ? std::atoi(argv[2]) : 20);
+  options.errorRate = (argc > 3 ? std::atof(argv[3]) : 0.0) / 100.0;
+  // A GFE slow to answer Create that asks for the video permission, as on a
+  // first run, so the first plays arrive before it is ready
+  options.createLatency = std::chrono::milliseconds(250);
+  options.askPermission = true;
+  // Turned off in GFE from the start, Assist as well halfway through
+  options.disabledHighlights = {"HighFive"};
+  // Not in GFE's settings at all, which does not mean turned off
+  options.unlistedHighlights = {"Save"};
+
+  LogSetLevel(BL_LOG_ERROR);
+  LogStart();
+  FakeGfeSdkInstall(options);
+
+  HighlightCore core(&ResolveSimEventName);
+  core.LoadConfig();
+  // Plays come every 200ms instead of every few seconds
+  core.SetEventDelay(0.0);
+  core.SetGlobalLimit(RateLimit::Unlimited());
+  core.SetCoalesceWindow(std::chrono::milliseconds(100));
+  // Shots and high fives are not worth a clip, the summary shows the best
+  core.SetMinSignificance(1);
+  core.SetSummarySignificance(2);
+  auto startBegin = std::chrono::steady_clock::now();
+  core.Start("", 0);
+  double startMs = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - startBegin)
+                       .count();
+  if (argc > 4)
+    core.StartCapture(argv[4]);
+  std::string statPath =
+      (std::filesystem::temp_directory_path() / "bakelite_sim_stats.bin").string();
+  std::remove(statPath.c_str());
+  LifetimeStatsOpen statsCreated = core.OpenLifetimeStats(statPath);
+  core.SetLocalPlayer(kStriker);
+  core.OnMatchEnter(false);
+
+  uint32_t goalsScored = 0;
+  uint32_t savesMade = 0;
+  // Compound highlights the plays should make
+  uint64_t compounds = 0;
+  for (int play = 0; play < plays; play++) {
+    if (play == plays / 2)
+      FakeGfeSdkCloseOverlay({"HighFive", "Assist"});
+    // A second of match clock per play, so the last plays are in the final 10s
+    int secondsRemaining = plays - play;
+    core.SetGameClock(secondsRemaining, false);
+    if (play % 4 == 1) {
+      // Clears the way for the striker's goal
+      core.HandleStatEvent(Event(kDemolish), kStriker);
+      compounds++;
+    }
+    if (play % 4 == 3) {
+      core.HandleStatEvent(Event(kSave), kPasser);
+      savesMade++;
+      if (savesMade % 3 == 0)
+        compounds++;
+    }
+    else {
+      core.HandleStatEvent(Event(kShot), kStriker);
+      core.HandleStatEvent(Event(kGoal), kStriker);
+      core.HandleStatEvent(Event(kAssist), kPasser);
+      core.HandleStatEvent(Event(kUnknown), kStriker);
+      Sleep(20);
+      core.HandleStatEvent(Event(kHighFive), kStriker);
+      goalsScored++;
+      if (secondsRemaining <= 10)
+        compounds++;
+    }
+    Sleep(200);
+  }
+  core.OnMatchExit(true);
+  if (argc > 4)
+    std::printf("capture: %zu records written to %s\n", core.StopCapture(), argv[4]);
+
+  // Let the coalescer flush and every callback arrive
+  for (int wait = 0; wait < 200; wait++) {
+    if (core.WorkerStats().depth == 0 && core.InFlight() == 0 &&
+        FakeGfeSdkGetCounters().pending == 0)
+      break;
+    Sleep(10);
+  }
+  core.Stop();
+
+  SdkWorkerStats worker = core.WorkerStats();
+  std::printf("worker: enqueued %llu, dispatched %llu, dropped %llu, latency avg %.1fus max %.1fus, polls %llu\n",
+              (unsigned long long)worker.enqueued,
+              (unsigned long long)worker.dispatched,
+              (unsigned long long)worker.dropped, worker.latencyAvgUs,
+              worker.latencyMaxUs, worker.polls);
+  std::printf("clips: %llu requests -> %llu clips, %.1fs of video saved, %llu batches, %llu batched failures\n",
+              (unsigned long long)worker.clips.requests,
+              (unsigned long long)worker.clips.clips,
+              worker.clips.savedMs / 1000.0,
+              (unsigned long long)worker.clipBatches,
+              (unsigned long long)worker.clipBatchFailures);
+  std::printf("retries: queued %llu, resubmitted %llu, recovered %llu, dropped %llu, expired %llu\n",
+              (unsigned long long)worker.retries.queued,
+              (unsigned long long)worker.retries.resubmitted,
+              (unsigned long long)worker.retries.recovered,
+              (unsigned long long)worker.retries.dropped,
+              (unsigned long long)worker.retries.expired);
+  // Clips sent for events turned off in GFE, only the first plays before the
+  // settings arrive may have any
+  size_t disabledSent = 0;
+  size_t lowValueSent = 0;
+  size_t unlistedSent = 0;
+  int summaryFilter = -1;
+  for (FakeGfeSdkCall const& call : FakeGfeSdkCalls()) {
+    if (call.type == SDK_CALL_SAVE_VIDEO && call.highlightId == "HighFive")
+      disabledSent++;
+    if (call.type == SDK_CALL_SAVE_VIDEO && call.highlightId == "Shot")
+      lowValueSent++;
+    if (call.type == SDK_CALL_SAVE_VIDEO && call.highlightId == "Save")
+      unlistedSent++;
+    if (call.type == SDK_CALL_OPEN_SUMMARY)
+      summaryFilter = call.sigFilter;
+  }
+  SdkStatus settings;
+  core.Status(&settings);
+  bool unlistedEnabled = settings.numUserSettings >= 0 &&
+                         ((settings.userSettings >> core.Events().Find("Save")) & 1) != 0;
+  bool settingsOk = core.DisabledSkipped() > 0 && disabledSent <= 1 &&
+                    unlistedEnabled && unlistedSent > 0;
+  std::printf("user settings: %s, %llu events turned off in GFE skipped, %zu sent anyway, unlisted Save %s (%zu sent)\n",
+              settingsOk ? "PASS" : "FAIL",
+              (unsigned long long)core.DisabledSkipped(), disabledSent,
+              unlistedEnabled ? "enabled" : "disabled", unlistedSent);
+  bool significanceOk = core.LowValueSkipped() >= goalsScored && lowValueSent == 0 &&
+                        summaryFilter == (NVGSDK_HIGHLIGHT_SIGNIFICANCE_VERY_GOOD |
+                                          NVGSDK_HIGHLIGHT_SIGNIFICANCE_EXTREMELY_GOOD);
+  std::printf("significance: %s, %llu low value events skipped, %zu sent anyway, summary filter 0x%x\n",
+              significanceOk ? "PASS" : "FAIL",
+              (unsigned long long)core.LowValueSkipped(), lowValueSent, summaryFilter);
+  // A goal that ties the match or takes the lead goes up a tier only for the
+  // local team, and a blowout takes a tier off either team's
+  HighlightScorer scorer;
+  scorer.Load(core.Events());
+  int goalSlot = core.Events().Find("Goal");
+  GameClock early = {true, false, 200};
+  GameClock late = {true, false, 10};
+  int closeOwn = scorer.Score(goalSlot, {early, true, -1, true});
+  int closeOther = scorer.Score(goalSlot, {early, true, 0, false});
+  int closeLate = scorer.Score(goalSlot, {late, true, 0, true});
+  int blowoutOwn = scorer.Score(goalSlot, {early, true, 4, true});
+  int blowoutOther = scorer.Score(goalSlot, {late, true, -5, false});
+  bool marginOk = closeOwn == 3 && closeOther == 2 && closeLate == 3 &&
+                  blowoutOwn == 1 && blowoutOther == 2;
+  std::printf("score margin: %s, close goal tier %d (other team %d, late %d), blowout goal tier %d (other team late %d)\n",
+              marginOk ? "PASS" : "FAIL", closeOwn, closeOther, closeLate,
+              blowoutOwn, blowoutOther);
+  // Every event counts, whether or not it was throttled, turned off in GFE or
+  // known to the stat table at all
+  PlayerStatStore const& match = core.LastMatchStats();
+  uintptr_t striker = kStriker;
+  uintptr_t passer = kPasser;
+  bool statsOk = match.Players() == 2 && match.Overflowed() == 0 &&
+                 match.Get(striker, gameGoals) == goalsScored &&
+                 match.Get(striker, goals) == goalsScored &&
+                 match.Get(striker, gameShots) == goalsScored &&
+                 match.Get(striker, gameHighFives) == goalsScored &&
+                 match.Get(passer, gameAssists) == goalsScored &&
+                 match.Get(passer, gameSaves) == savesMade &&
+                 match.Get(passer, gameGoals) == 0 &&
+                 match.Get(striker, games) == 1 && match.Get(passer, games) == 1 &&
+                 core.MatchStats().Players() == 0;
+  std::printf("player stats: %s, striker %u goals %u shots, passer %u assists %u saves, %d players\n",
+              statsOk ? "PASS" : "FAIL", match.Get(striker, gameGoals),
+              match.Get(striker, gameShots), match.Get(passer, gameAssists),
+              match.Get(passer, gameSaves), match.Players());
+  // The stat file keeps the striker's totals across sessions, and after its
+  // live counters are torn
+  core.CloseLifetimeStats();
+  bool lifetimeOk = statsCreated == LifetimeStatsOpen::Created;
+  {
+    LifetimeStatStore store;
+    lifetimeOk = lifetimeOk && store.Open(statPath, 0) == LifetimeStatsOpen::Live &&
+                 store.Sessions() == 2 && store.Lifetime(goals) == goalsScored &&
+                 store.Lifetime(games) == 1 && store.Lifetime(assists) == 0 &&
+                 store.Session(goals) == 0;
+  }
+  if (FILE* file = std::fopen(statPath.c_str(), "r+b")) {
+    // Sessions word of the live block, past the header, checksum and generation
+    std::fseek(file, 40, SEEK_SET);
+    std::fputc(0x5A, file);
+    std::fclose(file);
+  }
+  LifetimeStatsOpen torn;
+  {
+    LifetimeStatStore store;
+    torn = store.Open(statPath, 0);
+    lifetimeOk = lifetimeOk && torn == LifetimeStatsOpen::Checkpoint &&
+                 store.Sessions() == 3 && store.Lifetime(goals) == goalsScored;
+  }
+  // A file of a newer format, as left by a newer plugin, must survive an
+  // older one
+  auto readStatFile = [&statPath]() {
+    std::string bytes;
+    if (FILE* file = std::fopen(statPath.c_str(), "rb")) {
+      char block[4096];
+      size_t read;
+      while ((read = std::fread(block, 1, sizeof(block), file)) > 0)
+        bytes.append(block, read);
+      std::fclose(file);
+    }
+    return bytes;
+  };
+  if (FILE* file = std::fopen(statPath.c_str(), "r+b")) {
+    // Format version, past the magic
+    std::fseek(file, 8, SEEK_SET);
+    std::fputc(kNewerStatFormat, file);
+    std::fclose(file);
+  }
+  std::string newer = readStatFile();
+  LifetimeStatsOpen newerOpen;
+  {
+    LifetimeStatStore store;
+    newerOpen = store.Open(statPath, 0);
+  }
+  lifetimeOk = lifetimeOk && newerOpen == LifetimeStatsOpen::Failed &&
+               readStatFile() == newer;
+  std::remove(statPath.c_str());
+  std::printf("lifetime stats: %s, %u goals kept across sessions, torn file %s, newer format %s\n",
+              lifetimeOk ? "PASS" : "FAIL", goalsScored, LifetimeStatsOpenName(torn),
+              LifetimeStatsOpenName(newerOpen));
+  RuleEngineStats rules = core.Rules().Stats();
+  bool rulesOk = rules.completed == compounds && core.Rules().Rules() == 3;
+  std::printf("compound highlights: %s, %llu of %llu expected, %llu started, %llu expired, %llu evicted\n",
+              rulesOk ? "PASS" : "FAIL", (unsigned long long)rules.completed,
+              (unsigned long long)compounds, (unsigned long long)rules.started,
+              (unsigned long long)rules.expired, (unsigned long long)rules.evicted);
+  // Start must return long before the 250ms Create does, and nothing held
+  // until GFE was configured may be lost
+  bool startupOk = startMs < 50.0 && worker.startup.readyMs >= 250.0 &&
+                   worker.startup.buffered > 0 && worker.held.held > 0 &&
+                   worker.held.flushed == worker.held.held;
+  std::printf("startup: %s, Start returned after %.2fms, ready after %.0fms (bind %.0fms, create %.0fms), %llu commands buffered\n",
+              startupOk ? "PASS" : "FAIL", startMs, worker.startup.readyMs,
+              worker.startup.bindMs, worker.startup.createMs,
+              (unsigned long long)worker.startup.buffered);
+  std::printf("held until ready: %llu, flushed %llu, expired %llu, overflowed %llu, max wait %.0fms\n",
+              (unsigned long long)worker.held.held,
+              (unsigned long long)worker.held.flushed,
+              (unsigned long long)worker.held.expired,
+              (unsigned long long)worker.held.overflowed, worker.held.maxWaitMs);
+  if (SdkRequestTable const* requests = core.Requests()) {
+    for (std::string const& line : SdkRequestReport(requests, &RetCodeName))
+      std::printf("%s\n", line.c_str());
+  }
+  SdkStatus status;
+  core.Status(&status);
+  char statusLine[256];
+  SdkStatusFormat(&status, statusLine, sizeof(statusLine));
+  std::printf("gfe status (version %llu): %s\n", (unsigned long long)status.version, statusLine);
+  SdkContextPoolStats pool = core.ContextPoolStats();
+  std::printf("context pool: %zu/%zu slots in use, high water %zu, exhausted %llu, oversized %llu\n",
+              pool.inUse, pool.capacity, pool.highWater,
+              (unsigned long long)pool.exhausted, (unsigned long long)pool.oversized);
+  FakeGfeSdkCounters fake = FakeGfeSdkGetCounters();
+  std::printf("fake sdk: %zu calls, %llu callbacks, %llu polls, created %llu, released %llu\n",
+              FakeGfeSdkCalls().size(), (unsigned long long)fake.callbacks,
+              (unsigned long long)fake.polls, (unsigned long long)fake.created,
+              (unsigned long long)fake.released);
+
+  size_t allocations = core.CountHotPathAllocations(100000);
+  std::printf("alloc: %s, %zu allocations over 100000 stat events\n",
+              allocations == 0 ? "PASS" : "FAIL", allocations);
+
+  LogStop();
+  bool passed = allocations == 0 && startupOk && settingsOk && significanceOk &&
+                marginOk && statsOk && lifetimeOk && rulesOk;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include "Bench.h"
+#include <cstdio>
+#include <map>
+
+#include "HighlightCore.h"
+#include "RateLimiter.h"
+
+namespace {
+
+// Event mix roughly matching a 3v3 lobby: mostly configured events plus a few
+// the plugin has no config for.
+char const* const kEventMix[] = {"Shot",     "Save",       "Center", "Clear",
+                                 "Goal",     "Assist",     "HighFive",
+                                 "Demolish", "FirstTouch", "EpicSave",
+                                 "Unknown",  "Shot",       "Clear"};
+constexpr size_t kEventMixSize = sizeof(kEventMix) / sizeof(kEventMix[0]);
+
+}  // namespace
+
+std::vector<BenchResult> RunCoreBenchmarks(EventTable const& table,
+                                           int iterations,
+                                           BenchAllocCounter allocations) {
+  std::vector<BenchResult> results;
+  if (iterations <= 0)
+    return results;
+  volatile long long sink = 0;
+
+  // Old dispatch: a std::map keyed by the event name string
+  std::map<std::string, HighlightsDataHolder> byName;
+  for (size_t slot = 0; slot < table.size(); ++slot)
+    byName[table.Name(static_cast<int>(slot))] = table[static_cast<int>(slot)];
+  results.push_back(RunBench("resolve_map", iterations, allocations, [&](int i) {
+    std::string eventString = kEventMix[i % kEventMixSize];
+    if (byName.find(eventString) != byName.end())
+      sink = sink + byName[eventString].startDelta + byName[eventString].endDelta;
+  }));
+
+  results.push_back(RunBench("resolve_table", iterations, allocations, [&](int i) {
+    int slot = table.Find(kEventMix[i % kEventMixSize]);
+    if (slot != EventTable::kInvalidSlot)
+      sink = sink + table[slot].startDelta + table[slot].endDelta;
+  }));
+
+  // Stand-ins for the StatEvent objects, one per entry of the mix
+  std::vector<uintptr_t> objects(kEventMixSize);
+  for (size_t i = 0; i < kEventMixSize; ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      if (std::string_view(kEventMix[j]) == kEventMix[i]) {
+        objects[i] = objects[j];
+        break;
+      }
+    }
+    if (objects[i] == 0)
+      objects[i] = reinterpret_cast<uintptr_t>(&objects[i]);
+  }
+  StatEventCache cache;
+  results.push_back(RunBench("resolve_cache", iterations, allocations, [&](int i) {
+    size_t mix = i % kEventMixSize;
+    int slot = cache.Lookup(objects[mix]);
+    if (slot == StatEventCache::kUnresolved) {
+      slot = table.Find(kEventMix[mix]);
+      cache.Insert(objects[mix], slot);
+    }
+    if (slot != EventTable::kInvalidSlot)
+      sink = sink + table[slot].startDelta + table[slot].endDelta;
+  }));
+
+  // Plugin defaults, with a stat event every 50ms so both outcomes are taken
+  RateLimiter limiter;
+  limiter.Resize(table.size());
+  limiter.SetAllEventLimits(RateLimit::Interval(3.0));
+  limiter.SetGlobalLimit(RateLimit{2.0, 4.0});
+  RateLimiter::Clock::time_point now = RateLimiter::Clock::now();
+  int numSlots = static_cast<int>(table.size());
+  results.push_back(RunBench("cooldown", iterations, allocations, [&](int i) {
+    now += std::chrono::milliseconds(50);
+    sink = sink + limiter.TryAdmit(i % numSlots, now);
+  }));
+
+  std::vector<NVGSDK_Highlight> highlights;
+  results.push_back(RunBench("highlight_table", iterations, allocations, [&](int) {
+    highlights.clear();
+    highlights.shrink_to_fit();
+    BuildHighlightTable(table, highlights);
+    sink = sink + highlights.size();
+  }));
+  return results;
+}
+
+std::string FormatBenchResult(BenchResult const& result) {
+  char line[160];
+  std::snprintf(line, sizeof(line), "%-20s %10.1f ns/op %8.2f allocs/op (%llu ops)",
+                result.name.c_str(), result.nsPerOp, result.allocsPerOp,
+                static_cast<unsigned long long>(result.ops));
+  return line;
+}
+
+std::string BenchResultsToJson(std::vector<BenchResult> const& results) {
+  std::string json = "{\"benchmarks\": [";
+  char entry[200];
+  for (size_t i = 0; i < results.size(); ++i) {
+    BenchResult const& result = results[i];
+    std::snprintf(entry, sizeof(entry),
+                  "%s\n  {\"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.2f, "
+                  "\"allocs_per_op\": %.3f}",
+                  i > 0 ? "," : "", result.name.c_str(),
+                  static_cast<unsigned long long>(result.ops), result.nsPerOp,
+                  result.allocsPerOp);
+    json += entry;
+  }
+  json += "\n]}";
+  return json;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "EventTable.h"
+
+// Heap allocations made so far by the calling thread, e.g. ThreadAllocationCount
+using BenchAllocCounter = size_t (*)();
+
+struct BenchResult {
+  std::string name;
+  uint64_t ops;
+  double nsPerOp;
+  double allocsPerOp;
+};
+
+// Times `ops` calls of `op(i)` and the allocations they make
+template <typename Op>
+BenchResult RunBench(char const* name, int ops, BenchAllocCounter allocations,
+                     Op&& op) {
+  size_t allocationsBefore = allocations();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ops; ++i)
+    op(i);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  size_t made = allocations() - allocationsBefore;
+  return {name, static_cast<uint64_t>(ops),
+          std::chrono::duration<double, std::nano>(elapsed).count() / ops,
+          static_cast<double>(made) / ops};
+}
+
+// Benchmarks of the game thread side of the core, needing no SDK:
+//   resolve_map    old std::map<std::string> dispatch, per stat event
+//   resolve_table  EventTable::Find on the event name, per stat event
+//   resolve_cache  StatEventCache lookup in front of the table, per stat event
+//   cooldown       per event and global rate limit check of OnRecordingTrigger
+//   highlight_table  building the NVGSDK_Highlight table of LoadConfig
+std::vector<BenchResult> RunCoreBenchmarks(EventTable const& table,
+                                           int iterations,
+                                           BenchAllocCounter allocations);
+
+// "name: ns/op, allocs/op" lines, or a JSON document for comparing runs
+std::string FormatBenchResult(BenchResult const& result);
+std::string BenchResultsToJson(std::vector<BenchResult> const& results);
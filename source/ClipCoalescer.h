@@ -0,0 +1,165 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// A video highlight request with its capture window in absolute steady_clock
+// nanoseconds, so requests made at different times can be compared.
+struct ClipRequest {
+  char const* highlightId;
+  char const* groupId;
+  int64_t startNs;
+  int64_t endNs;
+  // Higher priority names the clip when requests are merged
+  int priority;
+  // HighlightScorer tier of the capture, a merged clip keeps the highest
+  int tier;
+};
+
+struct ClipCoalescerStats {
+  uint64_t requests;
+  uint64_t clips;
+  // Video that would have been written twice without merging
+  uint64_t savedMs;
+};
+
+// Holds video highlight requests for a short window and merges the ones whose
+// capture windows overlap or nearly touch, so a goal (plus its assist, high
+// five, shot...) becomes one clip covering the union of their ranges instead of
+// several near identical files. Only used by the SDK worker thread; stats may
+// be read from any thread.
+class ClipCoalescer {
+ public:
+  // Gaps shorter than this are bridged rather than cutting two clips
+  static constexpr int64_t kAdjacentGapNs = 1000000000;
+
+  // Queues a request until holdNs after its arrival. Returns false when the
+  // request could not be held and must be sent as is, which is always the case
+  // when holdNs <= 0.
+  bool Add(ClipRequest const& request, int64_t nowNs, int64_t holdNs) {
+    AddStat(requests, 1);
+    if (holdNs <= 0) {
+      AddStat(clips, 1);
+      return false;
+    }
+    for (size_t i = 0; i < numPending; ++i) {
+      Pending& clip = pending[i];
+      if (!Touches(clip.request, request))
+        continue;
+      Merge(clip.request, request);
+      clip.requestedNs += request.endNs - request.startNs;
+      // The grown clip may now reach another pending one
+      for (size_t j = 0; j < numPending;) {
+        if (j != i && Touches(pending[i].request, pending[j].request)) {
+          Merge(pending[i].request, pending[j].request);
+          pending[i].requestedNs += pending[j].requestedNs;
+          if (pending[j].flushAtNs < pending[i].flushAtNs)
+            pending[i].flushAtNs = pending[j].flushAtNs;
+          Remove(j);
+          // Remove moved the last clip into j, which may have been clip i
+          if (i == numPending)
+            i = j;
+          j = 0;
+          continue;
+        }
+        ++j;
+      }
+      return true;
+    }
+    if (numPending == kMaxPending) {
+      AddStat(clips, 1);
+      return false;
+    }
+    pending[numPending++] =
+        Pending{request, request.endNs - request.startNs, nowNs + holdNs};
+    return true;
+  }
+
+  int64_t NextFlushNs() const {
+    int64_t next = INT64_MAX;
+    for (size_t i = 0; i < numPending; ++i) {
+      if (pending[i].flushAtNs < next)
+        next = pending[i].flushAtNs;
+    }
+    return next;
+  }
+
+  size_t Depth() const { return numPending; }
+
+  // Hands every clip whose hold expired by nowNs to emit(ClipRequest const&)
+  template <typename F>
+  size_t Flush(int64_t nowNs, F&& emit) {
+    size_t flushed = 0;
+    for (size_t i = 0; i < numPending;) {
+      if (pending[i].flushAtNs > nowNs) {
+        ++i;
+        continue;
+      }
+      Pending clip = pending[i];
+      Remove(i);
+      int64_t savedNs = clip.requestedNs - (clip.request.endNs - clip.request.startNs);
+      AddStat(savedMs, static_cast<uint64_t>(savedNs > 0 ? savedNs : 0) / 1000000);
+      AddStat(clips, 1);
+      emit(clip.request);
+      ++flushed;
+    }
+    return flushed;
+  }
+
+  template <typename F>
+  size_t FlushAll(F&& emit) {
+    return Flush(INT64_MAX, emit);
+  }
+
+  ClipCoalescerStats Stats() const {
+    ClipCoalescerStats stats;
+    stats.requests = requests.load(std::memory_order_relaxed);
+    stats.clips = clips.load(std::memory_order_relaxed);
+    stats.savedMs = savedMs.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  static constexpr size_t kMaxPending = 16;
+
+  struct Pending {
+    ClipRequest request;
+    // Summed length of the requests merged into this clip
+    int64_t requestedNs;
+    int64_t flushAtNs;
+  };
+
+  static bool Touches(ClipRequest const& a, ClipRequest const& b) {
+    return (a.groupId == b.groupId || std::strcmp(a.groupId, b.groupId) == 0) &&
+           a.startNs <= b.endNs + kAdjacentGapNs &&
+           b.startNs <= a.endNs + kAdjacentGapNs;
+  }
+
+  static void Merge(ClipRequest& into, ClipRequest const& from) {
+    if (from.startNs < into.startNs)
+      into.startNs = from.startNs;
+    if (from.endNs > into.endNs)
+      into.endNs = from.endNs;
+    if (from.tier > into.tier)
+      into.tier = from.tier;
+    if (from.priority > into.priority) {
+      into.priority = from.priority;
+      into.highlightId = from.highlightId;
+    }
+  }
+
+  // Single writer, so plain load + store keeps the counters cheap
+  static void AddStat(std::atomic<uint64_t>& stat, uint64_t value) {
+    stat.store(stat.load(std::memory_order_relaxed) + value,
+               std::memory_order_relaxed);
+  }
+
+  void Remove(size_t i) { pending[i] = pending[--numPending]; }
+
+  Pending pending[kMaxPending];
+  size_t numPending = 0;
+  std::atomic<uint64_t> requests{0};
+  std::atomic<uint64_t> clips{0};
+  std::atomic<uint64_t> savedMs{0};
+};
@@ -0,0 +1,122 @@
+#include "CompoundRules.h"
+
+#include "Log.h"
+
+size_t RuleEngine::Compile(std::vector<CompoundRule> const& rules,
+                           EventTable const& events) {
+  compiled.clear();
+  slotRules.assign(events.size(), 0);
+  slotStarts.assign(events.size(), 0);
+  numPartials = 0;
+  stats = {};
+  for (CompoundRule const& rule : rules) {
+    Compiled c = {};
+    c.slot = events.Find(rule.id);
+    c.numSteps = rule.steps.size();
+    c.windowNs = static_cast<int64_t>(rule.withinMs) * 1000000;
+    c.samePlayer = rule.samePlayer;
+    c.finalSeconds = rule.finalSeconds;
+    bool valid = c.slot != EventTable::kInvalidSlot && c.numSteps > 0 &&
+                 c.numSteps <= kMaxSteps && compiled.size() < kMaxRules;
+    for (size_t step = 0; valid && step < c.numSteps; ++step) {
+      c.steps[step] = events.Find(rule.steps[step]);
+      valid = c.steps[step] != EventTable::kInvalidSlot;
+    }
+    if (!valid) {
+      BL_LOG(BL_LOG_ERROR, "Skipping compound highlight %s", rule.id.c_str());
+      continue;
+    }
+    uint32_t bit = 1u << compiled.size();
+    for (size_t step = 0; step < c.numSteps; ++step)
+      slotRules[c.steps[step]] |= bit;
+    slotStarts[c.steps[0]] |= bit;
+    compiled.push_back(c);
+  }
+  return compiled.size();
+}
+
+bool RuleEngine::FinalStepAllowed(Compiled const& rule, GameClock const& clock) {
+  if (rule.finalSeconds == 0)
+    return true;
+  return clock.known && !clock.overtime &&
+         clock.secondsRemaining <= rule.finalSeconds;
+}
+
+size_t RuleEngine::OnEvent(int slot, uintptr_t pri, int64_t nowNs,
+                           GameClock const& clock, int* completed) {
+  if (slot < 0 || static_cast<size_t>(slot) >= slotRules.size() ||
+      slotRules[slot] == 0)
+    return 0;
+
+  uint32_t done = 0;
+  // Advance before starting, so one event never counts for two steps
+  for (size_t i = 0; i < numPartials;) {
+    Partial& partial = partials[i];
+    Compiled const& rule = compiled[partial.rule];
+    if (nowNs - partial.startNs > rule.windowNs) {
+      stats.expired++;
+      Remove(i);
+      continue;
+    }
+    if (rule.steps[partial.state] != slot ||
+        (rule.samePlayer && partial.pri != pri) ||
+        ((done >> partial.rule) & 1) != 0) {
+      ++i;
+      continue;
+    }
+    if (partial.state + 1u < rule.numSteps) {
+      partial.state++;
+      ++i;
+      continue;
+    }
+    // A last step outside the final seconds leaves the match waiting for
+    // another one inside them
+    if (!FinalStepAllowed(rule, clock)) {
+      ++i;
+      continue;
+    }
+    done |= 1u << partial.rule;
+    Remove(i);
+  }
+
+  for (uint32_t starts = slotStarts[slot] & ~done; starts != 0;
+       starts &= starts - 1) {
+    size_t r = 0;
+    while (((starts >> r) & 1) == 0)
+      ++r;
+    Compiled const& rule = compiled[r];
+    if (rule.numSteps == 1) {
+      if (FinalStepAllowed(rule, clock))
+        done |= 1u << r;
+      continue;
+    }
+    if (numPartials == kMaxPartials) {
+      size_t oldest = 0;
+      for (size_t i = 1; i < numPartials; ++i) {
+        if (partials[i].startNs < partials[oldest].startNs)
+          oldest = i;
+      }
+      stats.evicted++;
+      Remove(oldest);
+    }
+    partials[numPartials++] = {static_cast<uint8_t>(r), 1, pri, nowNs};
+    stats.started++;
+  }
+
+  size_t numCompleted = 0;
+  for (size_t r = 0; r < compiled.size(); ++r) {
+    if (((done >> r) & 1) == 0)
+      continue;
+    completed[numCompleted++] = compiled[r].slot;
+    stats.completed++;
+    // The events that made this match do not make another one
+    for (size_t i = 0; i < numPartials;) {
+      if (partials[i].rule == r &&
+          (!compiled[r].samePlayer || partials[i].pri == pri))
+        Remove(i);
+      else
+        ++i;
+    }
+  }
+  return numCompleted;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "EventTable.h"
+
+// Match clock as shown on the scoreboard, set by the host before each event
+struct GameClock {
+  bool known;
+  bool overtime;
+  int secondsRemaining;
+};
+
+// A highlight made of several stat events, e.g. three saves within 20s. Its
+// id is registered with GFE like any event, with capture settings covering
+// the whole sequence.
+struct CompoundRule {
+  std::string id;
+  HighlightsDataHolder capture;
+  // Event names in the order they must happen
+  std::vector<std::string> steps;
+  // First to last step
+  int withinMs;
+  // Every step by the same PRI
+  bool samePlayer;
+  // Last step within this many seconds of the end of regulation, 0 for any
+  // time
+  int finalSeconds;
+};
+
+struct RuleEngineStats {
+  uint64_t started;
+  uint64_t completed;
+  // Partial matches that ran out of time
+  uint64_t expired;
+  // Oldest partial matches dropped for new ones while the pool was full
+  uint64_t evicted;
+};
+
+// Compound rules compiled into a table driven automaton over event slots.
+// A rule's state is the number of steps matched so far; per slot the engine
+// keeps the rules that slot may start or advance, so events no rule mentions
+// cost one table lookup. Partial matches live in a fixed pool, every event
+// advances each of them at most once, and nothing is allocated after Compile.
+// Game thread only.
+class RuleEngine {
+ public:
+  static constexpr size_t kMaxRules = 32;
+  static constexpr size_t kMaxSteps = 4;
+  static constexpr size_t kMaxPartials = 32;
+
+  // Resolves rule ids and steps to slots of events. Rules with an unknown
+  // event or too many steps are skipped with an error. Returns the number of
+  // rules compiled.
+  size_t Compile(std::vector<CompoundRule> const& rules,
+                 EventTable const& events);
+
+  // Feeds an event of slot by pri at nowNs. Writes the slot of every rule it
+  // completed to completed, which must hold kMaxRules, and returns how many.
+  size_t OnEvent(int slot, uintptr_t pri, int64_t nowNs,
+                 GameClock const& clock, int* completed);
+
+  // Drops every partial match, e.g. when a match starts
+  void Reset() { numPartials = 0; }
+
+  size_t Rules() const { return compiled.size(); }
+  size_t Partials() const { return numPartials; }
+  RuleEngineStats Stats() const { return stats; }
+
+ private:
+  struct Compiled {
+    int slot;
+    size_t numSteps;
+    int steps[kMaxSteps];
+    int64_t windowNs;
+    bool samePlayer;
+    int finalSeconds;
+  };
+
+  struct Partial {
+    uint8_t rule;
+    // Steps matched
+    uint8_t state;
+    uintptr_t pri;
+    int64_t startNs;
+  };
+
+  static bool FinalStepAllowed(Compiled const& rule, GameClock const& clock);
+  void Remove(size_t i) { partials[i] = partials[--numPartials]; }
+
+  std::vector<Compiled> compiled;
+  // Per slot, bit r set when rule r has a step of that slot
+  std::vector<uint32_t> slotRules;
+  // Per slot, bit r set when rule r starts with that slot
+  std::vector<uint32_t> slotStarts;
+  Partial partials[kMaxPartials];
+  size_t numPartials = 0;
+  RuleEngineStats stats = {};
+};
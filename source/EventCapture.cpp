@@ -0,0 +1,227 @@
+#include "EventCapture.h"
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t kMagic[8] = {'B', 'L', 'C', 'A', 'P', 0x01, 0x00, 0x00};
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+}  // namespace
+
+bool CaptureWriter::Open(std::string const& path, int64_t nowNs) {
+  Close();
+  file = std::fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+  buffer.reserve(kFlushBytes * 2);
+  buffer.assign(kMagic, kMagic + sizeof(kMagic));
+  lastNs = nowNs;
+  records = 0;
+  objectIds.clear();
+  priIds.clear();
+  priTeams.clear();
+  return true;
+}
+
+void CaptureWriter::Close() {
+  if (!file)
+    return;
+  Flush();
+  std::fclose(file);
+  file = nullptr;
+}
+
+void CaptureWriter::WriteObject(uintptr_t statEvent,
+                                std::string_view name,
+                                int64_t nowNs) {
+  uint32_t id = static_cast<uint32_t>(objectIds.size());
+  objectIds[statEvent] = id;
+  Begin(CaptureType::Object, nowNs);
+  PutVarint(id);
+  PutVarint(name.size());
+  buffer.insert(buffer.end(), name.begin(), name.end());
+}
+
+void CaptureWriter::WriteStatEvent(uintptr_t statEvent,
+                                   uintptr_t pri,
+                                   int64_t nowNs) {
+  auto object = objectIds.find(statEvent);
+  if (object == objectIds.end())
+    return;
+  uint32_t priId = PriId(pri);
+  Begin(CaptureType::StatEvent, nowNs);
+  PutVarint(object->second);
+  PutVarint(priId);
+}
+
+void CaptureWriter::WriteHotKey(HotKey key, int64_t nowNs) {
+  Begin(CaptureType::HotKey, nowNs);
+  buffer.push_back(static_cast<uint8_t>(key));
+}
+
+void CaptureWriter::WriteMatch(bool enter, int64_t nowNs) {
+  Begin(enter ? CaptureType::MatchEnter : CaptureType::MatchExit, nowNs);
+}
+
+void CaptureWriter::WriteGameClock(int secondsRemaining,
+                                   bool overtime,
+                                   int64_t nowNs) {
+  Begin(CaptureType::GameClock, nowNs);
+  buffer.push_back(overtime ? 1 : 0);
+  PutVarint(static_cast<uint64_t>(secondsRemaining > 0 ? secondsRemaining : 0));
+}
+
+void CaptureWriter::WriteScoreMargin(bool known, int margin, int64_t nowNs) {
+  Begin(CaptureType::ScoreMargin, nowNs);
+  buffer.push_back(known ? 1 : 0);
+  PutVarint(ZigZag(known ? margin : 0));
+}
+
+void CaptureWriter::WriteLocalPlayer(uintptr_t pri, int64_t nowNs) {
+  uint64_t id = pri != 0 ? PriId(pri) + uint64_t(1) : 0;
+  Begin(CaptureType::LocalPlayer, nowNs);
+  PutVarint(id);
+}
+
+void CaptureWriter::WritePlayerTeam(uintptr_t pri, int team, int64_t nowNs) {
+  auto known = priTeams.try_emplace(pri, team);
+  if (!known.second) {
+    if (known.first->second == team)
+      return;
+    known.first->second = team;
+  }
+  uint32_t priId = PriId(pri);
+  Begin(CaptureType::PlayerTeam, nowNs);
+  PutVarint(priId);
+  PutVarint(ZigZag(team));
+}
+
+uint32_t CaptureWriter::PriId(uintptr_t pri) {
+  return priIds.try_emplace(pri, static_cast<uint32_t>(priIds.size())).first->second;
+}
+
+void CaptureWriter::Begin(CaptureType type, int64_t nowNs) {
+  if (buffer.size() >= kFlushBytes)
+    Flush();
+  int64_t deltaUs = (nowNs - lastNs) / 1000;
+  // Keep the remainder so rounding does not drift over a long match
+  lastNs += deltaUs * 1000;
+  buffer.push_back(static_cast<uint8_t>(type));
+  PutVarint(static_cast<uint64_t>(deltaUs > 0 ? deltaUs : 0));
+  records++;
+}
+
+void CaptureWriter::PutVarint(uint64_t value) {
+  while (value >= 0x80) {
+    buffer.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back(static_cast<uint8_t>(value));
+}
+
+void CaptureWriter::Flush() {
+  if (!buffer.empty())
+    std::fwrite(buffer.data(), 1, buffer.size(), file);
+  buffer.clear();
+}
+
+bool CaptureReader::Open(std::string const& path) {
+  data.clear();
+  pos = sizeof(kMagic);
+  timeUs = 0;
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file)
+    return false;
+  uint8_t block[64 * 1024];
+  size_t read;
+  while ((read = std::fread(block, 1, sizeof(block), file)) > 0)
+    data.insert(data.end(), block, block + read);
+  std::fclose(file);
+  return data.size() >= sizeof(kMagic) &&
+         std::memcmp(data.data(), kMagic, sizeof(kMagic)) == 0;
+}
+
+bool CaptureReader::Next(CaptureRecord& record) {
+  if (pos >= data.size())
+    return false;
+  record = {};
+  record.type = static_cast<CaptureType>(data[pos++]);
+  uint64_t deltaUs;
+  if (!GetVarint(deltaUs))
+    return false;
+  timeUs += static_cast<int64_t>(deltaUs);
+  record.timeUs = timeUs;
+
+  uint64_t a, b;
+  switch (record.type) {
+    case CaptureType::Object:
+      if (!GetVarint(a) || !GetVarint(b) || b > data.size() - pos)
+        return false;
+      record.objectId = static_cast<uint32_t>(a);
+      record.name = std::string_view(
+          reinterpret_cast<char const*>(data.data() + pos), b);
+      pos += b;
+      return true;
+    case CaptureType::StatEvent:
+      if (!GetVarint(a) || !GetVarint(b))
+        return false;
+      record.objectId = static_cast<uint32_t>(a);
+      record.priId = static_cast<uint32_t>(b);
+      return true;
+    case CaptureType::HotKey:
+      if (pos >= data.size())
+        return false;
+      record.key = static_cast<HotKey>(data[pos++]);
+      return true;
+    case CaptureType::MatchEnter:
+    case CaptureType::MatchExit:
+      return true;
+    case CaptureType::GameClock:
+      if (pos >= data.size())
+        return false;
+      record.overtime = data[pos++] != 0;
+      if (!GetVarint(a))
+        return false;
+      record.secondsRemaining = static_cast<int32_t>(a);
+      return true;
+    case CaptureType::ScoreMargin:
+      if (pos >= data.size())
+        return false;
+      record.scoreKnown = data[pos++] != 0;
+      if (!GetVarint(a))
+        return false;
+      record.scoreMargin = static_cast<int32_t>(UnZigZag(a));
+      return true;
+    case CaptureType::LocalPlayer:
+      if (!GetVarint(a))
+        return false;
+      record.hasPlayer = a != 0;
+      record.priId = a != 0 ? static_cast<uint32_t>(a - 1) : 0;
+      return true;
+    case CaptureType::PlayerTeam:
+      if (!GetVarint(a) || !GetVarint(b))
+        return false;
+      record.priId = static_cast<uint32_t>(a);
+      record.team = static_cast<int32_t>(UnZigZag(b));
+      return true;
+  }
+  return false;
+}
+
+bool CaptureReader::GetVarint(uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+    uint8_t byte = data[pos++];
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
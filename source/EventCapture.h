@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Raw input stream of the core, as recorded by CaptureWriter.
+//
+// File layout: the 8 byte header "BLCAP" 0x01 0x00 0x00, then records of
+//   u8 type, varint microseconds since the previous record, payload
+// where varints are unsigned LEB128, zigzag encoded when signed. StatEvent and
+// PRI objects are replaced by small ids; the first time a StatEvent object is
+// seen an Object record gives its event name, so a match is a few bytes per
+// event. The game clock, score margin and local player are recorded when they
+// change, and the teams of a goal's players before the goal.
+enum class CaptureType : uint8_t {
+  // varint object id, varint length, name bytes
+  Object = 1,
+  // varint object id, varint PRI id
+  StatEvent = 2,
+  // u8 HotKey
+  HotKey = 3,
+  MatchEnter = 4,
+  MatchExit = 5,
+  // u8 overtime, varint seconds remaining
+  GameClock = 6,
+  // u8 known, signed varint margin
+  ScoreMargin = 7,
+  // varint PRI id + 1, 0 for none
+  LocalPlayer = 8,
+  // varint PRI id, signed varint team. Written when a goal needs a PRI's
+  // team, before the goal's StatEvent, and again when the team changes.
+  PlayerTeam = 9,
+};
+
+// Player actions bound to keys by the plugin
+enum class HotKey : uint8_t {
+  OpenSummary = 0,
+  PlayerEvent = 1,
+  ClearHighlights = 2,
+};
+
+struct CaptureRecord {
+  CaptureType type;
+  // Since the start of the capture
+  int64_t timeUs;
+  uint32_t objectId;
+  uint32_t priId;
+  HotKey key;
+  // GameClock records
+  bool overtime;
+  int32_t secondsRemaining;
+  // ScoreMargin records
+  bool scoreKnown;
+  int32_t scoreMargin;
+  // LocalPlayer records, priId is the player when set
+  bool hasPlayer;
+  // PlayerTeam records, of priId
+  int32_t team;
+  // Object records only, points into the reader's buffer
+  std::string_view name;
+};
+
+// Appends records to a capture file. Records are buffered and written in
+// blocks, so recording costs a few stores per event on the game thread.
+class CaptureWriter {
+ public:
+  ~CaptureWriter() { Close(); }
+
+  bool Open(std::string const& path, int64_t nowNs);
+  void Close();
+  bool IsOpen() const { return file != nullptr; }
+
+  // Returns true when the object has no id yet and its name must be recorded
+  // with WriteObject before the event
+  bool NeedsObject(uintptr_t statEvent) const {
+    return objectIds.find(statEvent) == objectIds.end();
+  }
+  void WriteObject(uintptr_t statEvent, std::string_view name, int64_t nowNs);
+  void WriteStatEvent(uintptr_t statEvent, uintptr_t pri, int64_t nowNs);
+  void WriteHotKey(HotKey key, int64_t nowNs);
+  void WriteMatch(bool enter, int64_t nowNs);
+  void WriteGameClock(int secondsRemaining, bool overtime, int64_t nowNs);
+  void WriteScoreMargin(bool known, int margin, int64_t nowNs);
+  void WriteLocalPlayer(uintptr_t pri, int64_t nowNs);
+  // Skipped when the PRI's team was already recorded
+  void WritePlayerTeam(uintptr_t pri, int team, int64_t nowNs);
+
+  size_t Records() const { return records; }
+
+ private:
+  static constexpr size_t kFlushBytes = 64 * 1024;
+
+  void Begin(CaptureType type, int64_t nowNs);
+  uint32_t PriId(uintptr_t pri);
+  void PutVarint(uint64_t value);
+  void Flush();
+
+  FILE* file = nullptr;
+  std::vector<uint8_t> buffer;
+  int64_t lastNs = 0;
+  size_t records = 0;
+  std::unordered_map<uintptr_t, uint32_t> objectIds;
+  std::unordered_map<uintptr_t, uint32_t> priIds;
+  std::unordered_map<uintptr_t, int> priTeams;
+};
+
+// Reads a whole capture file into memory and walks its records
+class CaptureReader {
+ public:
+  bool Open(std::string const& path);
+  // False at the end of the file or on a truncated record
+  bool Next(CaptureRecord& record);
+  size_t Bytes() const { return data.size(); }
+
+ private:
+  bool GetVarint(uint64_t& value);
+
+  std::vector<uint8_t> data;
+  size_t pos = 0;
+  int64_t timeUs = 0;
+};
@@ -0,0 +1,44 @@
+#include "EventTable.h"
+#include <algorithm>
+#include <cstring>
+
+EventTable::EventTable(
+    std::vector<std::pair<std::string, HighlightsDataHolder>> sorted) {
+  std::sort(sorted.begin(), sorted.end(),
+            [](auto const& a, auto const& b) { return a.first < b.first; });
+  names.reserve(sorted.size());
+  data.reserve(sorted.size());
+  for (auto& [name, holder] : sorted) {
+    names.push_back(std::move(name));
+    data.push_back(holder);
+  }
+}
+
+int EventTable::Find(std::string_view name) const {
+  auto it = std::lower_bound(names.begin(), names.end(), name);
+  if (it == names.end() || *it != name)
+    return kInvalidSlot;
+  return static_cast<int>(it - names.begin());
+}
+
+void StatEventCache::Insert(uintptr_t statEvent, int slot) {
+  static_assert((kCapacity & (kCapacity - 1)) == 0,
+                "capacity must be a power of two");
+  static_assert(kCapacity == (1u << (64 - 57)), "Hash() yields 7 bits");
+  if (statEvent == 0)
+    return;
+  size_t i = Hash(statEvent);
+  for (size_t probe = 0; probe < kCapacity; ++probe) {
+    if (keys[i] == 0 || keys[i] == statEvent) {
+      keys[i] = statEvent;
+      slots[i] = static_cast<int16_t>(slot);
+      return;
+    }
+    i = (i + 1) & (kCapacity - 1);
+  }
+}
+
+void StatEventCache::Clear() {
+  std::memset(keys, 0, sizeof(keys));
+  std::memset(slots, 0, sizeof(slots));
+}
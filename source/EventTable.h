@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Capture settings of a single highlight event
+struct HighlightsDataHolder {
+  bool relevant;
+  int startDelta;
+  int endDelta;
+  // Names the clip when overlapping highlights are merged, higher wins
+  int priority;
+};
+
+// Dense table of highlight events.
+// Slots are sorted by event name so iteration order matches the highlight
+// table handed to GFE, and a slot index is stable for the lifetime of the table.
+class EventTable {
+ public:
+  static constexpr int kInvalidSlot = -1;
+
+  explicit EventTable(
+      std::vector<std::pair<std::string, HighlightsDataHolder>> events);
+
+  // Resolves an event name to its slot. Only meant for cold paths.
+  int Find(std::string_view name) const;
+
+  size_t size() const { return names.size(); }
+  std::string const& Name(int slot) const { return names[slot]; }
+  HighlightsDataHolder& operator[](int slot) { return data[slot]; }
+  HighlightsDataHolder const& operator[](int slot) const { return data[slot]; }
+
+ private:
+  std::vector<std::string> names;
+  std::vector<HighlightsDataHolder> data;
+};
+
+// Maps a StatEvent object to the EventTable slot it resolved to.
+// The game keeps one StatEvent object per event type alive, so after the first
+// occurrence of an event the name never needs to be read or compared again.
+class StatEventCache {
+ public:
+  // Returned by Lookup when the object has not been resolved yet
+  static constexpr int kUnresolved = -2;
+
+  StatEventCache() { Clear(); }
+
+  int Lookup(uintptr_t statEvent) const {
+    size_t i = Hash(statEvent);
+    for (size_t probe = 0; probe < kCapacity; ++probe) {
+      if (keys[i] == statEvent)
+        return slots[i];
+      if (keys[i] == 0)
+        return kUnresolved;
+      i = (i + 1) & (kCapacity - 1);
+    }
+    return kUnresolved;
+  }
+
+  // Remembers the slot (or EventTable::kInvalidSlot) for a StatEvent object.
+  // When the cache is full the object simply stays unresolved.
+  void Insert(uintptr_t statEvent, int slot);
+  void Clear();
+
+ private:
+  static constexpr size_t kCapacity = 128;
+
+  static size_t Hash(uintptr_t key) {
+    // UObjects are at least 8 byte aligned, drop the low bits before mixing
+    return static_cast<size_t>((static_cast<uint64_t>(key >> 3) *
+                                0x9E3779B97F4A7C15ull) >>
+                               57);
+  }
+
+  uintptr_t keys[kCapacity];
+  int16_t slots[kCapacity];
+};
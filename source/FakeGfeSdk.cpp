@@ -0,0 +1,412 @@
+#include "FakeGfeSdk.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct PendingCallback {
+  Clock::time_point due;
+  std::function<void()> deliver;
+};
+
+// State of one handle returned by FakeCreate. Sessions on different threads
+// only share the global call log, which recordCalls turns off.
+struct FakeHandle {
+  std::mutex mutex;
+  // Options as of Create
+  FakeGfeSdkOptions options;
+  uint32_t rng = 1;
+  std::deque<PendingCallback> pending;
+  NVGSDK_NotificationCallback notify = nullptr;
+  void* notifyContext = nullptr;
+  // Highlight ids from the last Configure, reported back by GetUserSettings
+  std::vector<std::string> configured;
+  std::vector<std::string> disabled;
+  // Successful video highlights per group, reported by GetNumberOfHighlights
+  std::map<std::string, uint16_t> saved;
+};
+
+struct FakeState {
+  std::mutex mutex;
+  FakeGfeSdkOptions options;
+  std::vector<FakeGfeSdkCall> calls;
+  std::vector<std::unique_ptr<FakeHandle>> handles;
+  uint64_t created = 0;
+  uint64_t released = 0;
+  std::atomic<uint64_t> polls{0};
+  std::atomic<uint64_t> callbacks{0};
+};
+
+FakeState g_fake;
+
+FakeHandle* State(NVGSDK_HANDLE* handle) {
+  return reinterpret_cast<FakeHandle*>(handle);
+}
+
+// xorshift32, deterministic per seed. Caller holds the handle's mutex.
+NVGSDK_RetCode NextResult(FakeHandle* state, double errorRate) {
+  uint32_t x = state->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  state->rng = x;
+  double roll = (x & 0xFFFFFF) / double(0x1000000);
+  return roll < errorRate ? NVGSDK_ERR_GENERIC : NVGSDK_SUCCESS;
+}
+
+// Records the call and schedules deliver(rc) for the next poll of the handle
+// after latency
+template <typename F>
+void Submit(NVGSDK_HANDLE* handle, FakeGfeSdkCall call, F&& deliver) {
+  FakeHandle* state = State(handle);
+  FakeGfeSdkOptions const& options = state->options;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    call.result = NextResult(state, options.errorRate);
+    NVGSDK_RetCode rc = call.result;
+    if (call.type == SDK_CALL_SAVE_VIDEO && NVGSDK_SUCCEEDED(rc))
+      state->saved[call.groupId]++;
+    state->pending.push_back(
+        {Clock::now() + options.latency,
+         [deliver = std::forward<F>(deliver), rc]() { deliver(rc); }});
+  }
+  if (options.recordCalls) {
+    std::lock_guard<std::mutex> lock(g_fake.mutex);
+    g_fake.calls.push_back(std::move(call));
+  }
+}
+
+FakeGfeSdkCall MakeCall(SdkCallType type,
+                        char const* highlightId = nullptr,
+                        char const* groupId = nullptr) {
+  FakeGfeSdkCall call = {};
+  call.type = type;
+  if (highlightId)
+    call.highlightId = highlightId;
+  if (groupId)
+    call.groupId = groupId;
+  return call;
+}
+
+NVGSDK_RetCode NVGSDKApi FakeCreate(NVGSDK_HANDLE** handle,
+                                    NVGSDK_CreateInputParams const* inParams,
+                                    NVGSDK_CreateResponse* outParams) {
+  std::chrono::milliseconds latency;
+  {
+    std::lock_guard<std::mutex> lock(g_fake.mutex);
+    latency = g_fake.options.createLatency;
+  }
+  if (latency.count() > 0)
+    std::this_thread::sleep_for(latency);
+  std::lock_guard<std::mutex> lock(g_fake.mutex);
+  g_fake.created++;
+  NVGSDK_RetCode rc = g_fake.options.createResult;
+  outParams->versionMajor = 1;
+  outParams->versionMinor = 1;
+  std::strncpy(outParams->gfeVersionStr, "fake", NVGSDK_MAX_LENGTH - 1);
+  if (NVGSDK_FAILED(rc))
+    return rc;
+  size_t count = inParams->scopeTableSize < outParams->scopePermissionTableSize
+                     ? inParams->scopeTableSize
+                     : outParams->scopePermissionTableSize;
+  for (size_t i = 0; i < count; ++i) {
+    outParams->scopePermissionTable[i].scope = inParams->scopeTable[i];
+    bool ask = g_fake.options.askPermission &&
+               inParams->scopeTable[i] == NVGSDK_SCOPE_HIGHLIGHTS_VIDEO;
+    outParams->scopePermissionTable[i].permission =
+        ask ? NVGSDK_PERMISSION_MUST_ASK : NVGSDK_PERMISSION_GRANTED;
+  }
+  outParams->scopePermissionTableSize = count;
+  std::unique_ptr<FakeHandle> state(new FakeHandle);
+  state->options = g_fake.options;
+  state->disabled = g_fake.options.disabledHighlights;
+  state->rng = g_fake.options.seed ? g_fake.options.seed : 1;
+  state->notify = inParams->notificationCallback;
+  state->notifyContext = inParams->notificationCallbackContext;
+  *handle = reinterpret_cast<NVGSDK_HANDLE*>(state.get());
+  g_fake.handles.push_back(std::move(state));
+  return rc;
+}
+
+NVGSDK_RetCode NVGSDKApi FakeRelease(NVGSDK_HANDLE* handle) {
+  std::lock_guard<std::mutex> lock(g_fake.mutex);
+  g_fake.released++;
+  // Pending callbacks die with the handle
+  for (size_t i = 0; i < g_fake.handles.size(); ++i) {
+    if (g_fake.handles[i].get() == State(handle)) {
+      g_fake.handles.erase(g_fake.handles.begin() + i);
+      break;
+    }
+  }
+  return NVGSDK_SUCCESS;
+}
+
+NVGSDK_RetCode NVGSDKApi FakePoll(NVGSDK_HANDLE* handle) {
+  FakeHandle* state = State(handle);
+  std::vector<std::function<void()>> due;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    Clock::time_point now = Clock::now();
+    // Callbacks are delivered in submission order, like the real IPC channel
+    while (!state->pending.empty() && state->pending.front().due <= now) {
+      due.push_back(std::move(state->pending.front().deliver));
+      state->pending.pop_front();
+    }
+  }
+  g_fake.polls.fetch_add(1, std::memory_order_relaxed);
+  g_fake.callbacks.fetch_add(due.size(), std::memory_order_relaxed);
+  // Outside the lock: callbacks may submit new calls
+  for (auto& deliver : due)
+    deliver();
+  return NVGSDK_SUCCESS;
+}
+
+NVGSDK_RetCode NVGSDKApi FakeSetLogLevel(NVGSDK_LogLevel) {
+  return NVGSDK_SUCCESS;
+}
+
+NVGSDK_RetCode NVGSDKApi FakeAttachLogListener(NVGSDK_LoggingCallback) {
+  return NVGSDK_SUCCESS;
+}
+
+void NVGSDKApi FakeRequestPermissionsAsync(
+    NVGSDK_HANDLE* handle,
+    NVGSDK_RequestPermissionsParams const*,
+    NVGSDK_EmptyCallback callback,
+    void* context) {
+  FakeHandle* state = State(handle);
+  Submit(handle, MakeCall(SDK_CALL_REQUEST_PERMISSIONS),
+         [state, callback, context](NVGSDK_RetCode rc) {
+           if (NVGSDK_SUCCEEDED(rc) && state->notify) {
+             NVGSDK_ScopePermission granted = {NVGSDK_SCOPE_HIGHLIGHTS_VIDEO,
+                                               NVGSDK_PERMISSION_GRANTED};
+             NVGSDK_Notification notification = {};
+             notification.context = state->notifyContext;
+             notification.permissionsChanged.scopePermissionTable = &granted;
+             notification.permissionsChanged.scopePermissionTableSize = 1;
+             state->notify(NVGSDK_NOTIFICATION_PERMISSIONS_CHANGED,
+                           &notification, state->notifyContext);
+           }
+           callback(rc, context);
+         });
+}
+
+void NVGSDKApi FakeGetUILanguageAsync(NVGSDK_HANDLE* handle,
+                                      NVGSDK_GetUILanguageCallback callback,
+                                      void* context) {
+  Submit(handle, MakeCall(SDK_CALL_GET_LANGUAGE), [callback, context](NVGSDK_RetCode rc) {
+    NVGSDK_Language language = {"en-US"};
+    callback(rc, NVGSDK_SUCCEEDED(rc) ? &language : nullptr, context);
+  });
+}
+
+void NVGSDKApi FakeConfigureAsync(NVGSDK_HANDLE* handle,
+                                  NVGSDK_HighlightConfigParams const* params,
+                                  NVGSDK_EmptyCallback callback,
+                                  void* context) {
+  std::vector<std::string> ids;
+  for (size_t i = 0; i < params->highlightTableSize; ++i)
+    ids.push_back(params->highlightDefinitionTable[i].id);
+  {
+    FakeHandle* state = State(handle);
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->configured = std::move(ids);
+  }
+  Submit(handle, MakeCall(SDK_CALL_CONFIGURE),
+         [callback, context](NVGSDK_RetCode rc) { callback(rc, context); });
+}
+
+void NVGSDKApi FakeGetUserSettingsAsync(
+    NVGSDK_HANDLE* handle,
+    NVGSDK_Highlights_GetUserSettingsCallback callback,
+    void* context) {
+  FakeHandle* state = State(handle);
+  Submit(handle, MakeCall(SDK_CALL_GET_USER_SETTINGS),
+         [state, callback, context](NVGSDK_RetCode rc) {
+           std::vector<std::string> ids;
+           std::vector<std::string> disabled;
+           {
+             std::lock_guard<std::mutex> lock(state->mutex);
+             std::vector<std::string> const& unlisted =
+                 state->options.unlistedHighlights;
+             for (std::string const& id : state->configured) {
+               if (std::find(unlisted.begin(), unlisted.end(), id) == unlisted.end())
+                 ids.push_back(id);
+             }
+             disabled = state->disabled;
+           }
+           std::vector<NVGSDK_HighlightUserSetting> table(ids.size());
+           for (size_t i = 0; i < ids.size(); ++i) {
+             bool enabled = std::find(disabled.begin(), disabled.end(), ids[i]) ==
+                            disabled.end();
+             table[i] = {ids[i].c_str(), enabled};
+           }
+           NVGSDK_Highlights_UserSettings settings = {table.data(), table.size()};
+           callback(rc, NVGSDK_SUCCEEDED(rc) ? &settings : nullptr, context);
+         });
+}
+
+void NVGSDKApi FakeOpenGroupAsync(NVGSDK_HANDLE* handle,
+                                  NVGSDK_HighlightOpenGroupParams const* params,
+                                  NVGSDK_EmptyCallback callback,
+                                  void* context) {
+  Submit(handle, MakeCall(SDK_CALL_OPEN_GROUP, nullptr, params->groupId),
+         [callback, context](NVGSDK_RetCode rc) { callback(rc, context); });
+}
+
+void NVGSDKApi FakeCloseGroupAsync(NVGSDK_HANDLE* handle,
+                                   NVGSDK_HighlightCloseGroupParams const* params,
+                                   NVGSDK_EmptyCallback callback,
+                                   void* context) {
+  Submit(handle, MakeCall(SDK_CALL_CLOSE_GROUP, nullptr, params->groupId),
+         [callback, context](NVGSDK_RetCode rc) { callback(rc, context); });
+}
+
+void NVGSDKApi FakeSetScreenshotHighlightAsync(
+    NVGSDK_HANDLE* handle,
+    NVGSDK_ScreenshotHighlightParams const* params,
+    NVGSDK_EmptyCallback callback,
+    void* context) {
+  Submit(handle, MakeCall(SDK_CALL_SAVE_SCREENSHOT, params->highlightId, params->groupId),
+         [callback, context](NVGSDK_RetCode rc) { callback(rc, context); });
+}
+
+void NVGSDKApi FakeSetVideoHighlightAsync(
+    NVGSDK_HANDLE* handle,
+    NVGSDK_VideoHighlightParams const* params,
+    NVGSDK_EmptyCallback callback,
+    void* context) {
+  FakeGfeSdkCall call =
+      MakeCall(SDK_CALL_SAVE_VIDEO, params->highlightId, params->groupId);
+  call.startDelta = params->startDelta;
+  call.endDelta = params->endDelta;
+  Submit(handle, std::move(call),
+         [callback, context](NVGSDK_RetCode rc) { callback(rc, context); });
+}
+
+void NVGSDKApi FakeOpenSummaryAsync(NVGSDK_HANDLE* handle,
+                                    NVGSDK_SummaryParams const* params,
+                                    NVGSDK_EmptyCallback callback,
+                                    void* context) {
+  char const* group = params->groupSummaryTableSize > 0
+                          ? params->groupSummaryTable[0].groupId
+                          : nullptr;
+  FakeGfeSdkCall call = MakeCall(SDK_CALL_OPEN_SUMMARY, nullptr, group);
+  if (params->groupSummaryTableSize > 0) {
+    call.sigFilter = params->groupSummaryTable[0].significanceFilter;
+    call.tagFilter = params->groupSummaryTable[0].tagsFilter;
+  }
+  Submit(handle, call,
+         [callback, context](NVGSDK_RetCode rc) { callback(rc, context); });
+}
+
+void NVGSDKApi FakeGetNumberOfHighlightsAsync(
+    NVGSDK_HANDLE* handle,
+    NVGSDK_GroupView const* groupView,
+    NVGSDK_Highlights_GetNumberOfHighlightsCallback callback,
+    void* context) {
+  FakeHandle* state = State(handle);
+  std::string group = groupView->groupId;
+  Submit(handle, MakeCall(SDK_CALL_GET_NUM_HIGHLIGHTS, nullptr, groupView->groupId),
+         [state, callback, context, group](NVGSDK_RetCode rc) {
+           uint16_t count = 0;
+           {
+             std::lock_guard<std::mutex> lock(state->mutex);
+             auto saved = state->saved.find(group);
+             if (saved != state->saved.end())
+               count = saved->second;
+           }
+           NVGSDK_Highlights_NumberOfHighlights response = {count};
+           callback(rc, NVGSDK_SUCCEEDED(rc) ? &response : nullptr, context);
+         });
+}
+
+}  // namespace
+
+void FakeGfeSdkInstall(FakeGfeSdkOptions const& options) {
+  FakeGfeSdkSetOptions(options);
+  NVGSDK_Create = &FakeCreate;
+  NVGSDK_Release = &FakeRelease;
+  NVGSDK_Poll = &FakePoll;
+  NVGSDK_SetLogLevel = &FakeSetLogLevel;
+  NVGSDK_AttachLogListener = &FakeAttachLogListener;
+  NVGSDK_SetListenerLogLevel = &FakeSetLogLevel;
+  NVGSDK_RequestPermissionsAsync = &FakeRequestPermissionsAsync;
+  NVGSDK_GetUILanguageAsync = &FakeGetUILanguageAsync;
+  NVGSDK_Highlights_ConfigureAsync = &FakeConfigureAsync;
+  NVGSDK_Highlights_GetUserSettingsAsync = &FakeGetUserSettingsAsync;
+  NVGSDK_Highlights_OpenGroupAsync = &FakeOpenGroupAsync;
+  NVGSDK_Highlights_CloseGroupAsync = &FakeCloseGroupAsync;
+  NVGSDK_Highlights_SetScreenshotHighlightAsync = &FakeSetScreenshotHighlightAsync;
+  NVGSDK_Highlights_SetVideoHighlightAsync = &FakeSetVideoHighlightAsync;
+  NVGSDK_Highlights_OpenSummaryAsync = &FakeOpenSummaryAsync;
+  NVGSDK_Highlights_GetNumberOfHighlightsAsync = &FakeGetNumberOfHighlightsAsync;
+}
+
+void FakeGfeSdkSetOptions(FakeGfeSdkOptions const& options) {
+  std::lock_guard<std::mutex> lock(g_fake.mutex);
+  g_fake.options = options;
+}
+
+void FakeGfeSdkReset() {
+  std::lock_guard<std::mutex> lock(g_fake.mutex);
+  g_fake.calls.clear();
+  g_fake.created = 0;
+  g_fake.released = 0;
+  g_fake.polls = 0;
+  g_fake.callbacks = 0;
+  for (auto& state : g_fake.handles) {
+    std::lock_guard<std::mutex> handleLock(state->mutex);
+    state->pending.clear();
+    state->saved.clear();
+    state->rng = g_fake.options.seed ? g_fake.options.seed : 1;
+  }
+}
+
+void FakeGfeSdkCloseOverlay(std::vector<std::string> const& disabled) {
+  std::lock_guard<std::mutex> lock(g_fake.mutex);
+  for (auto& handle : g_fake.handles) {
+    FakeHandle* state = handle.get();
+    std::lock_guard<std::mutex> handleLock(state->mutex);
+    state->disabled = disabled;
+    if (!state->notify)
+      continue;
+    state->pending.push_back({Clock::now(), [state]() {
+                                NVGSDK_Notification notification = {};
+                                notification.context = state->notifyContext;
+                                notification.overlayStateChanged.open = false;
+                                notification.overlayStateChanged.state =
+                                    NVGSDK_OVERLAY_STATE_MAIN;
+                                state->notify(NVGSDK_NOTIFICATION_OVERLAY_STATE_CHANGED,
+                                              &notification, state->notifyContext);
+                              }});
+  }
+}
+
+std::vector<FakeGfeSdkCall> FakeGfeSdkCalls() {
+  std::lock_guard<std::mutex> lock(g_fake.mutex);
+  return g_fake.calls;
+}
+
+FakeGfeSdkCounters FakeGfeSdkGetCounters() {
+  std::lock_guard<std::mutex> lock(g_fake.mutex);
+  FakeGfeSdkCounters counters = {};
+  counters.created = g_fake.created;
+  counters.released = g_fake.released;
+  counters.polls = g_fake.polls.load(std::memory_order_relaxed);
+  counters.callbacks = g_fake.callbacks.load(std::memory_order_relaxed);
+  for (auto& state : g_fake.handles) {
+    std::lock_guard<std::mutex> handleLock(state->mutex);
+    counters.pending += state->pending.size();
+  }
+  return counters;
+}
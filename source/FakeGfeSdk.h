@@ -0,0 +1,76 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GfeSDKWrapper.h"
+#include "SdkRequests.h"
+
+struct FakeGfeSdkOptions {
+  // Delay between an async call and its callback becoming deliverable by
+  // NVGSDK_Poll
+  std::chrono::milliseconds latency{0};
+  // Fraction of async calls (0-1) completing with NVGSDK_ERR_GENERIC
+  double errorRate = 0.0;
+  // Report the video scope as "must ask" from Create so Init goes through
+  // RequestPermissions first
+  bool askPermission = false;
+  NVGSDK_RetCode createResult = NVGSDK_SUCCESS;
+  // How long Create blocks, as the IPC handshake with a slow or starting GFE
+  // does
+  std::chrono::milliseconds createLatency{0};
+  // Seed of the error injection, runs with the same seed fail the same calls
+  uint32_t seed = 1;
+  // Highlight ids GetUserSettings reports as turned off by the user
+  std::vector<std::string> disabledHighlights;
+  // Highlight ids GetUserSettings leaves out of its table, as GFE does for
+  // highlights it has not registered
+  std::vector<std::string> unlistedHighlights;
+  // Keep every call for FakeGfeSdkCalls. Off for benchmarks, where sessions
+  // on several threads would contend on the log.
+  bool recordCalls = true;
+};
+
+// One async call as seen by the fake
+struct FakeGfeSdkCall {
+  SdkCallType type;
+  std::string highlightId;
+  std::string groupId;
+  int startDelta;
+  int endDelta;
+  // OpenSummary only, of the first group
+  int sigFilter;
+  int tagFilter;
+  NVGSDK_RetCode result;
+};
+
+struct FakeGfeSdkCounters {
+  uint64_t created;
+  uint64_t released;
+  uint64_t polls;
+  uint64_t callbacks;
+  // Callbacks submitted but not delivered yet
+  size_t pending;
+};
+
+// In-process stand-in for GfeSDK.dll.
+// FakeGfeSdkInstall points every NVGSDK_* function of GfeSDKWrapper.h at the
+// fake, which records each call and queues its callback until it is due and
+// the handle is polled, as GFE does with pollForCallbacks. Every Create makes
+// a handle with its own queue, error sequence and highlight counts. Calls may
+// come from any thread; callbacks run on the thread polling their handle.
+void FakeGfeSdkInstall(FakeGfeSdkOptions const& options);
+// Options are taken by each handle at Create
+void FakeGfeSdkSetOptions(FakeGfeSdkOptions const& options);
+// Forgets recorded calls and counters, pending callbacks of every handle are
+// dropped
+void FakeGfeSdkReset();
+
+// As if the user changed highlight settings in the overlay and closed it: every
+// handle reports disabled from now on, and gets an overlay closed notification
+// on its next poll
+void FakeGfeSdkCloseOverlay(std::vector<std::string> const& disabled);
+
+std::vector<FakeGfeSdkCall> FakeGfeSdkCalls();
+FakeGfeSdkCounters FakeGfeSdkGetCounters();
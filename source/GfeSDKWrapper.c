@@ -7,78 +7,125 @@
 * license agreement from NVIDIA CORPORATION is strictly prohibited.
 */
 
-#include <Windows.h>
-
 #include "GfeSDKWrapper.h"
+#include "Log.h"
+#include "SdkBatch.h"
+#include "SdkContextPool.h"
+#include "SdkRequests.h"
+#include "SdkStatus.h"
 
 #include <gfesdk/sdk_types.h>
 #include <gfesdk/isdk.h>
 
-#include <stdarg.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-char g_logBuffer[512];
-void dbgprint(const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    vsprintf_s(g_logBuffer, sizeof(g_logBuffer) / sizeof(g_logBuffer[0]), fmt, args);
-    printf(g_logBuffer);
-    printf("\n");
-    OutputDebugStringA(g_logBuffer);
-    OutputDebugStringA("\n");
-    va_end(args);
-}
-#define LOG(fmt, ...) dbgprint(fmt, __VA_ARGS__)
-
-#define VALIDATE_HANDLE() \
-    if (!g_sdk) {               \
-        LOG("Invalid handle!"); \
-        return;                 \
-    }
-#define COUNT_OF(x) ((sizeof(x)/sizeof(0[x])) / ((size_t)(!(sizeof(x) % sizeof(0[x])))))
+#ifndef _MSC_VER
+// C99 inline: this translation unit provides the external definition
+extern inline const char* NVGSDK_RetCodeToString(NVGSDK_RetCode const ret);
+#endif
 
-NVGSDK_HANDLE* g_sdk = NULL;
-#define MAX_QUERY_STRING 2000
-wchar_t g_lastQueryResult[MAX_QUERY_STRING];
-wchar_t g_lastResult[NVGSDK_MAX_LENGTH];
-wchar_t g_permissionStr[NVGSDK_MAX_LENGTH];
-wchar_t g_overlayStateStr[NVGSDK_MAX_LENGTH];
+#define LOG(...) BL_LOG(BL_LOG_INFO, __VA_ARGS__)
+#define LOG_ERROR(...) BL_LOG(BL_LOG_ERROR, __VA_ARGS__)
 
-static void ConfigureHighlights(char const* defaultLocale, NVGSDK_Highlight* highlights, size_t numHighlights);
-static void __stdcall handleNotification(NVGSDK_NotificationType type, NVGSDK_Notification const* response, void* context);
-static void __stdcall handlePermissionChanged(NVGSDK_ScopePermission* scopePermissionTable, size_t size);
-static void __stdcall handleGenericResponse(NVGSDK_RetCode rc, void* context);
-static void __stdcall handlePermissionRequested(NVGSDK_RetCode rc, void* context);
-static void updateResultString(NVGSDK_RetCode rc);
+#define VALIDATE_HANDLE() VALIDATE_HANDLE_OR()
+#define VALIDATE_HANDLE_OR(result)          \
+    if (!session || !session->sdk) {        \
+        LOG_ERROR("Invalid handle!");       \
+        return result;                      \
+    }
+#define COUNT_OF(x) ((sizeof(x)/sizeof(0[x])) / ((size_t)(!(sizeof(x) % sizeof(0[x])))))
 
-typedef struct
+NVGSDK_Createfn NVGSDK_Create;
+NVGSDK_Releasefn NVGSDK_Release;
+NVGSDK_Pollfn NVGSDK_Poll;
+NVGSDK_SetLogLevelfn NVGSDK_SetLogLevel;
+NVGSDK_AttachLogListenerfn NVGSDK_AttachLogListener;
+NVGSDK_SetListenerLogLevelfn NVGSDK_SetListenerLogLevel;
+NVGSDK_RequestPermissionsAsyncfn NVGSDK_RequestPermissionsAsync;
+NVGSDK_GetUILanguageAsyncfn NVGSDK_GetUILanguageAsync;
+NVGSDK_Highlights_ConfigureAsyncfn NVGSDK_Highlights_ConfigureAsync;
+NVGSDK_Highlights_GetUserSettingsAsyncfn NVGSDK_Highlights_GetUserSettingsAsync;
+NVGSDK_Highlights_OpenGroupAsyncfn NVGSDK_Highlights_OpenGroupAsync;
+NVGSDK_Highlights_CloseGroupAsyncfn NVGSDK_Highlights_CloseGroupAsync;
+NVGSDK_Highlights_SetScreenshotHighlightAsyncfn NVGSDK_Highlights_SetScreenshotHighlightAsync;
+NVGSDK_Highlights_SetVideoHighlightAsyncfn NVGSDK_Highlights_SetVideoHighlightAsync;
+NVGSDK_Highlights_OpenSummaryAsyncfn NVGSDK_Highlights_OpenSummaryAsync;
+NVGSDK_Highlights_GetNumberOfHighlightsAsyncfn NVGSDK_Highlights_GetNumberOfHighlightsAsync;
+
+struct GfeSdkSession
 {
+    NVGSDK_HANDLE* sdk;
+    // Table passed to Init, configured once recording is permitted. User
+    // settings are reported by position in it.
     char const* defaultLocale;
     NVGSDK_Highlight* highlights;
     size_t numHighlights;
-} TConfigHolder;
+    SdkRequestTable* requests;
+    SdkContextPool* contexts;
+    SdkStatusCell* status;
+    // Batches with items still in flight, finished by DeInit
+    SdkBatch* batches;
+    GfeSdkCompletionHandler completed;
+    void* completedContext;
+    // Advanced by the permission, configure and open group callbacks
+    SdkReadiness readiness;
+    bool groupOpened;
+};
+
+void ConfigureHighlights(GfeSdkSession* session, char const* defaultLocale, NVGSDK_Highlight* highlights, size_t numHighlights);
+static void NVGSDKApi handleNotification(NVGSDK_NotificationType type, NVGSDK_Notification const* response, void* context);
+static void NVGSDKApi handlePermissionChanged(GfeSdkSession* session, NVGSDK_ScopePermission* scopePermissionTable, size_t size);
+static void NVGSDKApi handleGenericResponse(NVGSDK_RetCode rc, void* context);
+void SetCompletionHandler(GfeSdkSession* session, GfeSdkCompletionHandler handler, void* context);
+static void NVGSDKApi handleBatchItem(NVGSDK_RetCode rc, void* context);
+static void NVGSDKApi handlePermissionRequested(NVGSDK_RetCode rc, void* context);
+static void NVGSDKApi handleGroupOpened(NVGSDK_RetCode rc, void* context);
+
+static void setReadiness(GfeSdkSession* session, SdkReadiness readiness)
+{
+    if (session->readiness == readiness)
+    {
+        return;
+    }
+    session->readiness = readiness;
+    SdkStatusSetReadiness(session->status, readiness);
+    BL_LOG(BL_LOG_DEBUG, "GFE session: %s", SdkReadinessName(readiness));
+}
 
-void __stdcall handlePermissionRequested(NVGSDK_RetCode rc, void* context)
+void NVGSDKApi handlePermissionRequested(NVGSDK_RetCode rc, void* context)
 {
-    updateResultString(rc);
-    TConfigHolder* configHolder = context;
+    GfeSdkSession* session = SdkRequestOwner(context);
+    SdkRequestEnd(context, rc);
+    SdkStatusSetResult(session->status, rc);
 
     if (NVGSDK_SUCCEEDED(rc))
     {
-        ConfigureHighlights(configHolder->defaultLocale, configHolder->highlights, configHolder->numHighlights);
+        ConfigureHighlights(session, session->defaultLocale, session->highlights, session->numHighlights);
+    }
+    else
+    {
+        setReadiness(session, SDK_READINESS_FAILED);
     }
-
-    free(context);
 }
 
-void Init(char const* gameName, char const* defaultLocale, NVGSDK_Highlight* highlights, size_t numHighlights, char const* targetPath, int targetPid)
+GfeSdkSession* Init(char const* gameName, char const* defaultLocale, NVGSDK_Highlight* highlights, size_t numHighlights, char const* targetPath, int targetPid)
 {
-    memset(g_lastQueryResult, 0, MAX_QUERY_STRING);
-    memset(g_lastResult, 0, NVGSDK_MAX_LENGTH);
-    memset(g_permissionStr, 0, NVGSDK_MAX_LENGTH);
-    memset(g_overlayStateStr, 0, NVGSDK_MAX_LENGTH);
+    GfeSdkSession* session = calloc(1, sizeof(GfeSdkSession));
+    session->defaultLocale = defaultLocale;
+    session->highlights = highlights;
+    session->numHighlights = numHighlights;
+    session->requests = SdkRequestTableCreate(session);
+    session->contexts = SdkContextPoolCreate();
+    session->status = SdkStatusCreate();
+
+    if (!NVGSDK_Create)
+    {
+        LOG_ERROR("GfeSDK functions are not bound, highlights are disabled");
+        return session;
+    }
 
     //! [Creation C]
     NVGSDK_CreateInputParams inParams;
@@ -87,11 +134,12 @@ void Init(char const* gameName, char const* defaultLocale, NVGSDK_Highlight* hig
     NVGSDK_Scope scopes[] = { NVGSDK_SCOPE_HIGHLIGHTS, NVGSDK_SCOPE_HIGHLIGHTS_VIDEO };
     NVGSDK_ScopePermission scopePermissions[COUNT_OF(scopes)];
 
-    inParams.appName = "Rocket League";
+    inParams.appName = gameName;
     inParams.pollForCallbacks = true;
     inParams.scopeTable = &scopes[0];
     inParams.scopeTableSize = COUNT_OF(scopes);
     inParams.notificationCallback = handleNotification;
+    inParams.notificationCallbackContext = session;
 
     if (targetPath != NULL && targetPid != 0)
     {
@@ -104,7 +152,7 @@ void Init(char const* gameName, char const* defaultLocale, NVGSDK_Highlight* hig
     outParams.scopePermissionTable = &scopePermissions[0];
     outParams.scopePermissionTableSize = COUNT_OF(scopes);
 
-    NVGSDK_RetCode rc = NVGSDK_Create(&g_sdk, &inParams, &outParams);
+    NVGSDK_RetCode rc = NVGSDK_Create(&session->sdk, &inParams, &outParams);
     if (NVGSDK_SUCCEEDED(rc))
     {
         // Valid handle has been returned
@@ -124,7 +172,7 @@ void Init(char const* gameName, char const* defaultLocale, NVGSDK_Highlight* hig
     else
     {
         // No valid handle
-        LOG("Failure: %s", NVGSDK_RetCodeToString(rc));
+        LOG_ERROR("Failure: %s", NVGSDK_RetCodeToString(rc));
         switch (rc)
         {
         case NVGSDK_ERR_SDK_VERSION:
@@ -138,11 +186,12 @@ void Init(char const* gameName, char const* defaultLocale, NVGSDK_Highlight* hig
             LOG("PC is running GfeSDK version %d.%d", outParams.versionMajor, outParams.versionMinor);
             break;
         }
-        return;
+        session->sdk = NULL;
+        return session;
     }
     //! [Creation C]
 
-    handlePermissionChanged(outParams.scopePermissionTable, outParams.scopePermissionTableSize);
+    handlePermissionChanged(session, outParams.scopePermissionTable, outParams.scopePermissionTableSize);
 
     //! [Permissions C]
     // Request Permissions if user hasn't decided yet
@@ -164,74 +213,96 @@ void Init(char const* gameName, char const* defaultLocale, NVGSDK_Highlight* hig
 
     if (requestPermissionsParams.scopeTableSize > 0)
     {
-        TConfigHolder* configHolder = malloc(sizeof(TConfigHolder));
-        configHolder->defaultLocale = defaultLocale;
-        configHolder->highlights = highlights;
-        configHolder->numHighlights = numHighlights;
-
         // If the user hasn't given permission for recording yet, ask them to do so now via overlay
-        NVGSDK_RequestPermissionsAsync(g_sdk, &requestPermissionsParams, &handlePermissionRequested, configHolder);
+        setReadiness(session, SDK_READINESS_AWAITING_PERMISSION);
+        NVGSDK_RequestPermissionsAsync(session->sdk, &requestPermissionsParams, &handlePermissionRequested, SdkRequestBegin(session->requests, SDK_CALL_REQUEST_PERMISSIONS, NULL));
     }
     else
     {
         // Otherwise, go ahead and set up now
-        ConfigureHighlights(defaultLocale, highlights, numHighlights);
+        ConfigureHighlights(session, defaultLocale, highlights, numHighlights);
     }
     //! [Permissions C]
+    return session;
 }
 
-void DeInit()
+void DeInit(GfeSdkSession* session)
 {
     VALIDATE_HANDLE();
 
     //! [Release C]
-    NVGSDK_Release(g_sdk);
+    NVGSDK_Release(session->sdk);
     //! [Release C]
+    session->sdk = NULL;
+    setReadiness(session, SDK_READINESS_NO_HANDLE);
+    // Their callbacks will not come any more
+    SdkBatchCancelPending(&session->batches, NVGSDK_ERR_INVALID_HANDLE);
+}
+
+void DestroySession(GfeSdkSession* session)
+{
+    if (!session)
+    {
+        return;
+    }
+    SdkRequestTableDestroy(session->requests);
+    SdkContextPoolDestroy(session->contexts);
+    SdkStatusDestroy(session->status);
+    free(session);
 }
 
-void OnTick()
+void OnTick(GfeSdkSession* session)
 {
     VALIDATE_HANDLE();
 
-    NVGSDK_Poll(g_sdk);
+    NVGSDK_Poll(session->sdk);
 }
 
-void OnOpenGroup(char const* groupId)
+uint64_t OnOpenGroup(GfeSdkSession* session, char const* groupId)
 {
-    VALIDATE_HANDLE();
+    VALIDATE_HANDLE_OR(0);
 
     //! [OpenGroup C]
     NVGSDK_HighlightOpenGroupParams params = { 0 };
     params.groupId = groupId;
-    NVGSDK_Highlights_OpenGroupAsync(g_sdk, &params, &handleGenericResponse, NULL);
+    void* request = SdkRequestBegin(session->requests, SDK_CALL_OPEN_GROUP, NULL);
+    uint64_t id = SdkRequestId(request);
+    NVGSDK_Highlights_OpenGroupAsync(session->sdk, &params, &handleGroupOpened, request);
     //! [OpenGroup C]
+    return id;
 }
 
-void OnCloseGroup(char const* groupId, bool destroy)
+uint64_t OnCloseGroup(GfeSdkSession* session, char const* groupId, bool destroy)
 {
-    VALIDATE_HANDLE();
+    VALIDATE_HANDLE_OR(0);
 
     //! [CloseGroup C]
     NVGSDK_HighlightCloseGroupParams params = { 0 };
     params.groupId = groupId;
     params.destroyHighlights = destroy;
-    NVGSDK_Highlights_CloseGroupAsync(g_sdk, &params, &handleGenericResponse, NULL);
+    void* request = SdkRequestBegin(session->requests, SDK_CALL_CLOSE_GROUP, NULL);
+    uint64_t id = SdkRequestId(request);
+    NVGSDK_Highlights_CloseGroupAsync(session->sdk, &params, &handleGenericResponse, request);
     //! [CloseGroup C]
+    return id;
 }
 
-void OnSaveScreenshot(char const* highlightId, char const* groupId)
+uint64_t OnSaveScreenshot(GfeSdkSession* session, char const* highlightId, char const* groupId)
 {
-    VALIDATE_HANDLE();
+    VALIDATE_HANDLE_OR(0);
 
     NVGSDK_ScreenshotHighlightParams params;
     params.groupId = groupId;
     params.highlightId = highlightId;
-    NVGSDK_Highlights_SetScreenshotHighlightAsync(g_sdk, &params, &handleGenericResponse, NULL);
+    void* request = SdkRequestBegin(session->requests, SDK_CALL_SAVE_SCREENSHOT, NULL);
+    uint64_t id = SdkRequestId(request);
+    NVGSDK_Highlights_SetScreenshotHighlightAsync(session->sdk, &params, &handleGenericResponse, request);
+    return id;
 }
 
-void OnSaveVideo(char const* highlightId, char const* groupId, int startDelta, int endDelta)
+uint64_t OnSaveVideo(GfeSdkSession* session, char const* highlightId, char const* groupId, int startDelta, int endDelta)
 {
-    VALIDATE_HANDLE();
+    VALIDATE_HANDLE_OR(0);
 
     //! [SaveVideo C]
     NVGSDK_VideoHighlightParams params;
@@ -239,24 +310,63 @@ void OnSaveVideo(char const* highlightId, char const* groupId, int startDelta, i
     params.highlightId = highlightId;
     params.startDelta = startDelta;
     params.endDelta = endDelta;
-    NVGSDK_Highlights_SetVideoHighlightAsync(g_sdk, &params, &handleGenericResponse, NULL);
+    void* request = SdkRequestBegin(session->requests, SDK_CALL_SAVE_VIDEO, NULL);
+    uint64_t id = SdkRequestId(request);
+    NVGSDK_Highlights_SetVideoHighlightAsync(session->sdk, &params, &handleGenericResponse, request);
     //! [SaveVideo C]
+    return id;
 }
 
-void __stdcall handleSummaryOpened(NVGSDK_RetCode rc, void* context)
+void NVGSDKApi handleBatchItem(NVGSDK_RetCode rc, void* context)
 {
-    updateResultString(rc);
-    NVGSDK_SummaryParams* params = context;
-    free(params);
+    GfeSdkSession* session = SdkRequestOwner(context);
+    void* item = SdkRequestEnd(context, rc);
+    SdkStatusSetResult(session->status, rc);
+    SdkBatchItemDone(item, rc);
 }
 
-void OnOpenSummary(char const* groupIds[], size_t numGroups, int sigFilter, int tagFilter)
+SdkBatch* OnSaveVideoBatch(GfeSdkSession* session, GfeSdkVideoHighlight const* videos, size_t count)
+{
+    if (!session || !session->sdk)
+    {
+        // Still hand back a batch, already failed, so callers have one path
+        LOG_ERROR("Invalid handle!");
+        SdkBatch* rejected = NULL;
+        SdkBatch* batch = SdkBatchCreate(&rejected, count);
+        SdkBatchCancelPending(&rejected, NVGSDK_ERR_INVALID_HANDLE);
+        return batch;
+    }
+
+    SdkBatch* batch = SdkBatchCreate(&session->batches, count);
+    NVGSDK_VideoHighlightParams params;
+    for (size_t i = 0; i < count; ++i)
+    {
+        params.groupId = videos[i].groupId;
+        params.highlightId = videos[i].highlightId;
+        params.startDelta = videos[i].startDelta;
+        params.endDelta = videos[i].endDelta;
+        NVGSDK_Highlights_SetVideoHighlightAsync(session->sdk, &params, &handleBatchItem,
+            SdkRequestBegin(session->requests, SDK_CALL_SAVE_VIDEO, SdkBatchItem(batch, i)));
+    }
+    return batch;
+}
+
+void NVGSDKApi handleSummaryOpened(NVGSDK_RetCode rc, void* context)
+{
+    GfeSdkSession* session = SdkRequestOwner(context);
+    NVGSDK_SummaryParams* params = SdkRequestEnd(context, rc);
+    SdkStatusSetResult(session->status, rc);
+    SdkContextFree(session->contexts, params);
+}
+
+void OnOpenSummary(GfeSdkSession* session, char const* groupIds[], size_t numGroups, int sigFilter, int tagFilter)
 {
     VALIDATE_HANDLE();
 
     //! [OpenSummary C]
-    NVGSDK_SummaryParams* params = calloc(1, sizeof(NVGSDK_SummaryParams));
-    params->groupSummaryTable = calloc(numGroups, sizeof(NVGSDK_GroupView));
+    // The group table follows the params in the same context slot
+    NVGSDK_SummaryParams* params = SdkContextAlloc(session->contexts, sizeof(NVGSDK_SummaryParams) + numGroups * sizeof(NVGSDK_GroupView));
+    params->groupSummaryTable = (NVGSDK_GroupView*)(params + 1);
     params->groupSummaryTableSize = numGroups;
 
     for (size_t i = 0; i < numGroups; ++i)
@@ -266,20 +376,22 @@ void OnOpenSummary(char const* groupIds[], size_t numGroups, int sigFilter, int
         params->groupSummaryTable[i].tagsFilter = tagFilter;
     }
 
-    NVGSDK_Highlights_OpenSummaryAsync(g_sdk, params, &handleSummaryOpened, params);
+    NVGSDK_Highlights_OpenSummaryAsync(session->sdk, params, &handleSummaryOpened, SdkRequestBegin(session->requests, SDK_CALL_OPEN_SUMMARY, params));
     //! [OpenSummary C]
 }
 
-void __stdcall handleGotNumHighlights(NVGSDK_RetCode rc, NVGSDK_Highlights_NumberOfHighlights const* response, void* context)
+void NVGSDKApi handleGotNumHighlights(NVGSDK_RetCode rc, NVGSDK_Highlights_NumberOfHighlights const* response, void* context)
 {
-    updateResultString(rc);
+    GfeSdkSession* session = SdkRequestOwner(context);
+    SdkRequestEnd(context, rc);
+    SdkStatusSetResult(session->status, rc);
     if (NVGSDK_SUCCEEDED(rc))
     {
-        swprintf(g_lastQueryResult, MAX_QUERY_STRING, L"#: %d", response->numberOfHighlights);
+        SdkStatusSetNumHighlights(session->status, response->numberOfHighlights);
     }
 }
 
-void OnGetNumHighlights(char const* groupId, int sigFilter, int tagFilter)
+void OnGetNumHighlights(GfeSdkSession* session, char const* groupId, int sigFilter, int tagFilter)
 {
     VALIDATE_HANDLE();
 
@@ -288,172 +400,227 @@ void OnGetNumHighlights(char const* groupId, int sigFilter, int tagFilter)
     groupView.significanceFilter = sigFilter;
     groupView.tagsFilter = tagFilter;
 
-    NVGSDK_Highlights_GetNumberOfHighlightsAsync(g_sdk, &groupView, handleGotNumHighlights, NULL);
+    NVGSDK_Highlights_GetNumberOfHighlightsAsync(session->sdk, &groupView, handleGotNumHighlights, SdkRequestBegin(session->requests, SDK_CALL_GET_NUM_HIGHLIGHTS, NULL));
 }
 
-void __stdcall handleGotLanguage(NVGSDK_RetCode rc, NVGSDK_Language const* response, void* context)
+void NVGSDKApi handleGotLanguage(NVGSDK_RetCode rc, NVGSDK_Language const* response, void* context)
 {
-    updateResultString(rc);
+    GfeSdkSession* session = SdkRequestOwner(context);
+    SdkRequestEnd(context, rc);
+    SdkStatusSetResult(session->status, rc);
     if (NVGSDK_SUCCEEDED(rc))
     {
-        swprintf(g_lastQueryResult, MAX_QUERY_STRING, L"%hs", response->cultureCode);
+        SdkStatusSetLanguage(session->status, response->cultureCode);
     }
 }
 
-void OnRequestLanguage()
+void OnRequestLanguage(GfeSdkSession* session)
 {
     VALIDATE_HANDLE();
 
-    NVGSDK_GetUILanguageAsync(g_sdk, handleGotLanguage, NULL);
+    NVGSDK_GetUILanguageAsync(session->sdk, handleGotLanguage, SdkRequestBegin(session->requests, SDK_CALL_GET_LANGUAGE, NULL));
 }
 
-void __stdcall handleGotUserSettings(NVGSDK_RetCode rc, NVGSDK_Highlights_UserSettings const* response, void* context)
+void NVGSDKApi handleGotUserSettings(NVGSDK_RetCode rc, NVGSDK_Highlights_UserSettings const* response, void* context)
 {
-    updateResultString(rc);
+    GfeSdkSession* session = SdkRequestOwner(context);
+    SdkRequestEnd(context, rc);
+    SdkStatusSetResult(session->status, rc);
     if (NVGSDK_SUCCEEDED(rc))
     {
-        size_t endOfStr = 0;
+        // Only highlights GFE lists as turned off are, ids it left out of the
+        // table were not turned off by the user
+        uint64_t enabled = ~(uint64_t)0;
         for (size_t i = 0; i < response->highlightSettingTableSize; ++i)
         {
-            endOfStr += swprintf(g_lastQueryResult + endOfStr, MAX_QUERY_STRING - endOfStr, L"\n%hs: %hs", response->highlightSettingTable[i].id, response->highlightSettingTable[i].enabled ? "ON" : "OFF");
+            if (response->highlightSettingTable[i].enabled)
+            {
+                continue;
+            }
+            for (size_t slot = 0; slot < session->numHighlights && slot < SDK_MAX_USER_SETTINGS; ++slot)
+            {
+                if (strcmp(session->highlights[slot].id, response->highlightSettingTable[i].id) == 0)
+                {
+                    enabled &= ~((uint64_t)1 << slot);
+                    break;
+                }
+            }
         }
+        SdkStatusSetUserSettings(session->status, enabled, (int)response->highlightSettingTableSize);
     }
 }
 
-void OnRequestUserSettings()
+void OnRequestUserSettings(GfeSdkSession* session)
 {
     VALIDATE_HANDLE();
 
-    NVGSDK_Highlights_GetUserSettingsAsync(g_sdk, &handleGotUserSettings, NULL);
-}
-
-wchar_t const* GetCurrentPermissionStr()
-{
-    return g_permissionStr;
-}
-
-wchar_t const* GetLastOverlayEvent()
-{
-    return g_overlayStateStr;
-}
-
-wchar_t const* GetLastResult()
-{
-    return g_lastResult;
-}
-
-wchar_t const* GetLastQueryResult()
-{
-    return g_lastQueryResult;
+    NVGSDK_Highlights_GetUserSettingsAsync(session->sdk, &handleGotUserSettings, SdkRequestBegin(session->requests, SDK_CALL_GET_USER_SETTINGS, NULL));
 }
 
 void InitGfeSdkWrapper(GfeSdkWrapper* hl)
 {
     hl->Init = &Init;
     hl->DeInit = &DeInit;
+    hl->DestroySession = &DestroySession;
+    hl->SetCompletionHandler = &SetCompletionHandler;
+    hl->ConfigureHighlights = &ConfigureHighlights;
     hl->OnTick = &OnTick;
     hl->OnOpenGroup = &OnOpenGroup;
     hl->OnCloseGroup = &OnCloseGroup;
     hl->OnSaveScreenshot = &OnSaveScreenshot;
     hl->OnSaveVideo = &OnSaveVideo;
+    hl->OnSaveVideoBatch = &OnSaveVideoBatch;
     hl->OnGetNumHighlights = &OnGetNumHighlights;
     hl->OnOpenSummary = &OnOpenSummary;
     hl->OnRequestLanguage = &OnRequestLanguage;
     hl->OnRequestUserSettings = &OnRequestUserSettings;
-    hl->GetCurrentPermissionStr = &GetCurrentPermissionStr;
-    hl->GetLastOverlayEvent = &GetLastOverlayEvent;
-    hl->GetLastQueryResult = &GetLastQueryResult;
-    hl->GetLastResult = &GetLastResult;
 }
 
-void __stdcall handleConfigured(NVGSDK_RetCode rc, void* context)
+void NVGSDKApi handleConfigured(NVGSDK_RetCode rc, void* context)
 {
-    updateResultString(rc);
-
-    if (NVGSDK_FAILED(rc))
+    GfeSdkSession* session = SdkRequestOwner(context);
+    NVGSDK_HighlightConfigParams* params = SdkRequestEnd(context, rc);
+    SdkStatusSetResult(session->status, rc);
+    // The user may have turned highlights of the new table off
+    if (NVGSDK_SUCCEEDED(rc))
     {
-        return;
+        OnRequestUserSettings(session);
     }
-
-    NVGSDK_HighlightConfigParams* params = context;
-
-    for (size_t i = 0; i < params->highlightTableSize; ++i)
+    // Later reconfigurations leave a ready session as it is
+    if (session->readiness == SDK_READINESS_CONFIGURING)
     {
-        for (size_t name = 0; name < params->highlightDefinitionTable[i].nameTableSize; ++name)
+        if (NVGSDK_FAILED(rc))
+        {
+            setReadiness(session, SDK_READINESS_FAILED);
+        }
+        else
         {
-            free((void*)params->highlightDefinitionTable[i].nameTable[name].localeCode);
-            free((void*)params->highlightDefinitionTable[i].nameTable[name].localizedString);
+            setReadiness(session, session->groupOpened ? SDK_READINESS_READY : SDK_READINESS_OPENING_GROUP);
         }
-        free(params->highlightDefinitionTable[i].nameTable);
     }
 
-    free(params->highlightDefinitionTable);
+    // The params own a single arena, see ConfigureHighlights
     free(params);
 }
 
-void ConfigureHighlights(char const* defaultLocale, NVGSDK_Highlight* hl, size_t numHighlights)
+// Bytes taken by a copy of str in the arena, truncated to maxLength
+static size_t arenaStringSize(char const* str, size_t maxLength)
 {
-    // Re-creating the highlights table to show the sample code
+    if (str == NULL)
+    {
+        return 0;
+    }
+    size_t length = strlen(str);
+    return (length < maxLength ? length : maxLength) + 1;
+}
+
+static char const* arenaCopyString(char** cursor, char const* str, size_t maxLength)
+{
+    if (str == NULL)
+    {
+        return NULL;
+    }
+    size_t size = arenaStringSize(str, maxLength);
+    char* copy = *cursor;
+    memcpy(copy, str, size - 1);
+    copy[size - 1] = '\0';
+    *cursor += size;
+    return copy;
+}
+
+void ConfigureHighlights(GfeSdkSession* session, char const* defaultLocale, NVGSDK_Highlight* hl, size_t numHighlights)
+{
+    // The SDK reads the params until handleConfigured runs, so the whole
+    // definition table is copied into one allocation laid out as
+    //   params | highlights[numHighlights] | every nameTable | strings
+    // where the structs keep pointer alignment and strings are sized to fit.
+    size_t const maxName = NVGSDK_MAX_LENGTH - 1;
+    size_t numNames = 0;
+    size_t stringBytes = arenaStringSize(defaultLocale, SIZE_MAX);
+    for (size_t i = 0; i < numHighlights; ++i)
+    {
+        stringBytes += arenaStringSize(hl[i].id, SIZE_MAX);
+        numNames += hl[i].nameTableSize;
+        for (size_t name = 0; name < hl[i].nameTableSize; ++name)
+        {
+            stringBytes += arenaStringSize(hl[i].nameTable[name].localeCode, maxName);
+            stringBytes += arenaStringSize(hl[i].nameTable[name].localizedString, maxName);
+        }
+    }
+
+    size_t arenaSize = sizeof(NVGSDK_HighlightConfigParams)
+        + numHighlights * sizeof(NVGSDK_Highlight)
+        + numNames * sizeof(NVGSDK_LocalizedPair)
+        + stringBytes;
+    NVGSDK_HighlightConfigParams* params = malloc(arenaSize);
+    if (params == NULL)
+    {
+        LOG_ERROR("Could not allocate %zu bytes for the highlight table", arenaSize);
+        if (session->readiness == SDK_READINESS_CONFIGURING)
+        {
+            setReadiness(session, SDK_READINESS_FAILED);
+        }
+        return;
+    }
 
     //! [ConfigureHighlights C]
-    NVGSDK_Highlight* highlights = calloc(numHighlights, sizeof(NVGSDK_Highlight));
-    highlights[0].userInterest = false;
+    NVGSDK_Highlight* highlights = (NVGSDK_Highlight*)(params + 1);
+    NVGSDK_LocalizedPair* names = (NVGSDK_LocalizedPair*)(highlights + numHighlights);
+    char* strings = (char*)(names + numNames);
 
-    NVGSDK_HighlightConfigParams* params = calloc(1, sizeof(NVGSDK_HighlightConfigParams));
-    params->defaultLocale = defaultLocale;
+    params->defaultLocale = arenaCopyString(&strings, defaultLocale, SIZE_MAX);
     params->highlightDefinitionTable = highlights;
     params->highlightTableSize = numHighlights;
 
     for (size_t i = 0; i < numHighlights; ++i)
     {
-        highlights[i].id = hl[i].id;
+        highlights[i].id = arenaCopyString(&strings, hl[i].id, SIZE_MAX);
         highlights[i].highlightTags = hl[i].highlightTags;
         highlights[i].significance = hl[i].significance;
         highlights[i].userInterest = hl[i].userInterest;
 
         highlights[i].nameTableSize = hl[i].nameTableSize;
-        highlights[i].nameTable = hl[i].nameTableSize > 0 ? calloc(hl[i].nameTableSize, sizeof(NVGSDK_LocalizedPair)) : NULL;
-        for (size_t name = 0; name < hl[i].nameTableSize; ++name)
+        highlights[i].nameTable = hl[i].nameTableSize > 0 ? names : NULL;
+        for (size_t name = 0; name < hl[i].nameTableSize; ++name, ++names)
         {
-            highlights[i].nameTable[name].localeCode = calloc(NVGSDK_MAX_LENGTH, sizeof(char));
-            strncpy_s((char*)highlights[i].nameTable[name].localeCode, NVGSDK_MAX_LENGTH, hl[i].nameTable[name].localeCode, NVGSDK_MAX_LENGTH);
-            highlights[i].nameTable[name].localizedString = calloc(NVGSDK_MAX_LENGTH, sizeof(char));
-            strncpy_s((char*)highlights[i].nameTable[name].localizedString, NVGSDK_MAX_LENGTH, hl[i].nameTable[name].localizedString, NVGSDK_MAX_LENGTH);
+            names->localeCode = arenaCopyString(&strings, hl[i].nameTable[name].localeCode, maxName);
+            names->localizedString = arenaCopyString(&strings, hl[i].nameTable[name].localizedString, maxName);
         }
     }
 
-    NVGSDK_Highlights_ConfigureAsync(g_sdk, params, &handleConfigured, params);
+    if (session->readiness < SDK_READINESS_OPENING_GROUP)
+    {
+        setReadiness(session, SDK_READINESS_CONFIGURING);
+    }
+    NVGSDK_Highlights_ConfigureAsync(session->sdk, params, &handleConfigured, SdkRequestBegin(session->requests, SDK_CALL_CONFIGURE, params));
     //! [ConfigureHighlights C]
 }
 
-void __stdcall handleNotification(NVGSDK_NotificationType type, NVGSDK_Notification const* response, void* context)
+void NVGSDKApi handleNotification(NVGSDK_NotificationType type, NVGSDK_Notification const* response, void* context)
 {
+    GfeSdkSession* session = context;
     switch (type)
     {
     case NVGSDK_NOTIFICATION_PERMISSIONS_CHANGED:
-        handlePermissionChanged(response->permissionsChanged.scopePermissionTable, response->permissionsChanged.scopePermissionTableSize);
+        handlePermissionChanged(session, response->permissionsChanged.scopePermissionTable, response->permissionsChanged.scopePermissionTableSize);
         break;
     case NVGSDK_NOTIFICATION_OVERLAY_STATE_CHANGED:
-    {
-        size_t endOfStr = 0;
-        switch (response->overlayStateChanged.state)
+        SdkStatusSetOverlay(session->status, response->overlayStateChanged.state, response->overlayStateChanged.open);
+        // Highlight settings are changed in the overlay, read them again once
+        // it closes. Before configuration GFE does not know the table yet.
+        if (!response->overlayStateChanged.open
+            && (session->readiness == SDK_READINESS_OPENING_GROUP || session->readiness == SDK_READINESS_READY))
         {
-        case NVGSDK_OVERLAY_STATE_MAIN:                 endOfStr += swprintf(g_overlayStateStr, NVGSDK_MAX_LENGTH, L"%hs", "Main Overlay Window"); break;
-        case NVGSDK_OVERLAY_STATE_PERMISSION:           endOfStr += swprintf(g_overlayStateStr, NVGSDK_MAX_LENGTH, L"%hs", "Permission Overlay Window"); break;
-        case NVGSDK_OVERLAY_STATE_HIGHLIGHTS_SUMMARY:   endOfStr += swprintf(g_overlayStateStr, NVGSDK_MAX_LENGTH, L"%hs", "Highlights Summary Overlay Window"); break;
-        default:                                        endOfStr += swprintf(g_overlayStateStr, NVGSDK_MAX_LENGTH, L"%hs", "Unknown Window"); break;
+            OnRequestUserSettings(session);
         }
-
-        swprintf(g_overlayStateStr + endOfStr, NVGSDK_MAX_LENGTH - endOfStr, L" %hs", response->overlayStateChanged.open ? "OPEN" : "CLOSED");
         break;
-    }
     default:
         LOG("Unknown notification type");
         break;
     }
 }
 
-void __stdcall handlePermissionChanged(NVGSDK_ScopePermission* scopePermissionTable, size_t size)
+void NVGSDKApi handlePermissionChanged(GfeSdkSession* session, NVGSDK_ScopePermission* scopePermissionTable, size_t size)
 {
     NVGSDK_Permission permission = NVGSDK_PERMISSION_MUST_ASK;
     for (size_t i = 0; i < size; ++i)
@@ -464,21 +631,66 @@ void __stdcall handlePermissionChanged(NVGSDK_ScopePermission* scopePermissionTa
         }
     }
 
-    switch (permission)
+    SdkStatusSetPermission(session->status, permission);
+}
+
+void NVGSDKApi handleGenericResponse(NVGSDK_RetCode rc, void* context)
+{
+    GfeSdkSession* session = SdkRequestOwner(context);
+    uint64_t id = SdkRequestId(context);
+    SdkRequestEnd(context, rc);
+    SdkStatusSetResult(session->status, rc);
+    if (session->completed)
+    {
+        session->completed(session->completedContext, id, rc);
+    }
+}
+
+void NVGSDKApi handleGroupOpened(NVGSDK_RetCode rc, void* context)
+{
+    GfeSdkSession* session = SdkRequestOwner(context);
+    if (NVGSDK_SUCCEEDED(rc))
+    {
+        session->groupOpened = true;
+        if (session->readiness == SDK_READINESS_OPENING_GROUP)
+        {
+            setReadiness(session, SDK_READINESS_READY);
+        }
+    }
+    handleGenericResponse(rc, context);
+}
+
+void SetCompletionHandler(GfeSdkSession* session, GfeSdkCompletionHandler handler, void* context)
+{
+    if (!session)
     {
-    case NVGSDK_PERMISSION_MUST_ASK:    swprintf(g_permissionStr, NVGSDK_MAX_LENGTH, L"%hs", "Must Ask"); break;
-    case NVGSDK_PERMISSION_GRANTED:     swprintf(g_permissionStr, NVGSDK_MAX_LENGTH, L"%hs", "Granted"); break;
-    case NVGSDK_PERMISSION_DENIED:      swprintf(g_permissionStr, NVGSDK_MAX_LENGTH, L"%hs", "Denied"); break;
-    default:                            swprintf(g_permissionStr, NVGSDK_MAX_LENGTH, L"%hs", "Unknown"); break;
+        return;
     }
+    session->completed = handler;
+    session->completedContext = context;
+}
+
+bool GfeSdkSessionOpen(GfeSdkSession const* session)
+{
+    return session->sdk != NULL;
+}
+
+int GfeSdkSessionReadiness(GfeSdkSession const* session)
+{
+    return session->readiness;
+}
+
+SdkRequestTable* GfeSdkSessionRequests(GfeSdkSession const* session)
+{
+    return session->requests;
 }
 
-void __stdcall handleGenericResponse(NVGSDK_RetCode rc, void* context)
+SdkContextPool* GfeSdkSessionContexts(GfeSdkSession const* session)
 {
-    updateResultString(rc);
+    return session->contexts;
 }
 
-void updateResultString(NVGSDK_RetCode rc)
+SdkStatusCell* GfeSdkSessionStatus(GfeSdkSession const* session)
 {
-    swprintf(g_lastResult, NVGSDK_MAX_LENGTH, L"%hs", NVGSDK_RetCodeToString(rc));
+    return session->status;
 }
@@ -0,0 +1,440 @@
+#include "HighlightCore.h"
+#include <utility>
+#include "AllocCounter.h"
+#include "Log.h"
+
+char const* GROUP1_ID = "GROUP1";
+
+namespace {
+
+std::vector<std::pair<std::string, HighlightsDataHolder>> DefaultEvents() {
+  return {
+      {"Goal", {true, -5000, 3000, 80}},
+      {"EpicSave", {true, -5000, 3000, 70}},
+      {"Save", {true, -5000, 3000, 60}},
+      {"HighFive", {true, -5000, 3000, 10}},
+      {"Assist", {true, -8000, 5000, 50}},
+      {"Demolish", {false, -5000, 3000, 40}},
+      {"Demolition", {false, -2000, 3000, 40}},
+      {"Win", {false, 0, 3000, 35}},
+      {"MVP", {false, 0, 3000, 35}},
+      {"AerialGoal", {false, -5000, 3000, 90}},
+      {"BackwardsGoal", {false, -5000, 3000, 90}},
+      {"BicycleGoal", {false, -5000, 3000, 90}},
+      {"LongGoal", {false, -5000, 3000, 90}},
+      {"TurtleGoal", {false, -5000, 3000, 90}},
+      {"PoolShot", {false, -5000, 3000, 90}},
+      {"OvertimeGoal", {false, -5000, 3000, 90}},
+      {"HatTrick", {false, -5000, 3000, 95}},
+      {"Playmaker", {false, -5000, 3000, 55}},
+      {"Savior", {false, -5000, 3000, 65}},
+      {"Shot", {false, -5000, 3000, 30}},
+      {"Center", {false, -5000, 3000, 20}},
+      {"Clear", {false, -5000, 3000, 20}},
+      {"FirstTouch", {false, -5000, 3000, 10}},
+      {"BreakoutDamage", {false, -5000, 3000, 15}},
+      {"BreakoutDamageLarge", {false, -5000, 3000, 20}},
+      {"LowFive", {false, -5000, 3000, 10}},
+      {"HoopsSwishGoal", {false, -5000, 3000, 90}},
+      {"BicycleHit", {false, -5000, 3000, 25}},
+      {"OwnGoal", {true, -5000, 3000, 75}},
+      {"PlayerEvent", {true, -10000, 2000, 100}}};
+}
+
+// Clips start early enough to show the whole sequence
+std::vector<CompoundRule> DefaultRules() {
+  return {
+      {"DemoGoal", {true, -9000, 3000, 85}, {"Demolish", "Goal"}, 4000, true, 0},
+      {"TripleSave", {true, -25000, 3000, 85}, {"Save", "Save", "Save"}, 20000, false, 0},
+      {"LastSecondGoal", {true, -5000, 5000, 92}, {"Goal"}, 0, false, 10}};
+}
+
+// Compound highlights are events of their own to GFE, the rate limits and the
+// user's settings
+EventTable WithRules(std::vector<CompoundRule> const& rules) {
+  std::vector<std::pair<std::string, HighlightsDataHolder>> events =
+      DefaultEvents();
+  for (CompoundRule const& rule : rules)
+    events.emplace_back(rule.id, rule.capture);
+  return EventTable(std::move(events));
+}
+
+}  // namespace
+
+void BuildHighlightTable(EventTable const& events,
+                         std::vector<NVGSDK_Highlight>& highlights) {
+  highlights.resize(events.size());
+  for (int i = 0; i < static_cast<int>(events.size()); i++) {
+    highlights[i].id = events.Name(i).c_str();
+    highlights[i].userInterest = events[i].relevant;
+    EventScore score = BaseEventScore(events.Name(i), events[i].priority);
+    highlights[i].significance =
+        static_cast<NVGSDK_HighlightSignificance>(SignificanceOfTier(score.tier));
+    highlights[i].highlightTags = static_cast<NVGSDK_HighlightType>(score.tags);
+    highlights[i].nameTable = nullptr;
+    highlights[i].nameTableSize = 0;
+  }
+}
+
+HighlightCore::HighlightCore(EventNameResolver resolveName)
+    : resolveName(resolveName),
+      compoundRules(DefaultRules()),
+      events(WithRules(compoundRules)) {}
+
+void HighlightCore::LoadConfig() {
+  BL_LOG(BL_LOG_INFO, "Initializing Nvidia Geforce Experience Wrapper.");
+  InitGfeSdkWrapper(&sdk);
+
+  BuildHighlightTable(events, highlights);
+  scorer.Load(events);
+  for (int i = 0; i < static_cast<int>(events.size()); i++) {
+    BL_LOG(BL_LOG_DEBUG, "Event enabled: %s [%dms/%dms]",
+           events.Name(i).c_str(), events[i].startDelta, events[i].endDelta);
+  }
+  if (events.size() > SDK_MAX_USER_SETTINGS) {
+    BL_LOG(BL_LOG_ERROR,
+           "%zu highlights but GFE user settings only cover %d, the rest "
+           "are always sent",
+           events.size(), SDK_MAX_USER_SETTINGS);
+  }
+  playerEventSlot = events.Find("PlayerEvent");
+  size_t compiled = rules.Compile(compoundRules, events);
+  BL_LOG(BL_LOG_DEBUG, "Compiled %zu of %zu compound highlights", compiled,
+         compoundRules.size());
+  slotStats.resize(events.size());
+  for (int i = 0; i < static_cast<int>(events.size()); i++)
+    slotStats[i] = FindEventStat(events.Name(i));
+  statEventCache.Clear();
+  limiter.Resize(events.size());
+  eventLimitOverrides.assign(events.size(), std::nullopt);
+  ApplyRateLimits();
+}
+
+void HighlightCore::Start(std::string targetPath, int targetPid,
+                          std::function<bool()> bind) {
+  BL_LOG(BL_LOG_INFO, "Nvidia Shadowplay Init()");
+  worker.Start(&sdk, {std::move(bind), gameName, defaultLocale,
+                      highlights.data(), highlights.size(),
+                      std::move(targetPath), targetPid});
+  // Open group now, the worker runs it right after Init
+  queue->OpenGroup(GROUP1_ID);
+}
+
+void HighlightCore::Stop() {
+  BL_LOG(BL_LOG_INFO, "Nvidia Shadowplay DeInit()");
+  worker.Stop();
+  BL_LOG(BL_LOG_INFO, "Nvidia Shadowplay DeInit complete.");
+}
+
+void HighlightCore::SetEventDelay(double seconds) {
+  eventDelay = RateLimit::Interval(seconds);
+  ApplyRateLimits();
+}
+
+void HighlightCore::SetGlobalLimit(RateLimit limit) {
+  limiter.SetGlobalLimit(limit);
+}
+
+bool HighlightCore::SetEventLimit(std::string_view event,
+                                  std::optional<RateLimit> limit) {
+  int slot = events.Find(event);
+  if (slot == EventTable::kInvalidSlot)
+    return false;
+  eventLimitOverrides[slot] = limit;
+  limiter.SetEventLimit(slot, limit.value_or(eventDelay));
+  return true;
+}
+
+void HighlightCore::ApplyRateLimits() {
+  for (size_t slot = 0; slot < eventLimitOverrides.size(); slot++) {
+    limiter.SetEventLimit(static_cast<int>(slot),
+                          eventLimitOverrides[slot].value_or(eventDelay));
+  }
+}
+
+void HighlightCore::OnMatchEnter(bool clearHighlights) {
+  if (capture.IsOpen())
+    capture.WriteMatch(true, NowNs());
+  // StatEvent objects may be recreated between matches
+  statEventCache.Clear();
+  // So are PRIs, rows of the last match mean nothing now
+  matchStats.Reset();
+  rules.Reset();
+  context = {};
+  matchStartNs = NowNs();
+  matchClipStats = worker.Stats().clips;
+  // Don't close group if user doesn't open summary page or they will lose their recordings.
+  if (clearHighlights)
+    queue->CloseGroup(GROUP1_ID, true);
+  BL_LOG(BL_LOG_INFO, "Player entered match, creating Highlights group.");
+  queue->OpenGroup(GROUP1_ID);
+}
+
+void HighlightCore::OnMatchExit(bool showSummary) {
+  if (capture.IsOpen())
+    capture.WriteMatch(false, NowNs());
+  ClipCoalescerStats clips = worker.Stats().clips;
+  uint64_t requests = clips.requests - matchClipStats.requests;
+  uint64_t saved = requests - (clips.clips - matchClipStats.clips);
+  BL_LOG(BL_LOG_INFO,
+         "Match clips: %llu highlights merged into %llu, saved %llu SDK calls "
+         "and %.1fs of video",
+         (unsigned long long)requests, (unsigned long long)(requests - saved),
+         (unsigned long long)saved,
+         (clips.savedMs - matchClipStats.savedMs) / 1000.0);
+  matchClipStats = clips;
+  lastMatchStats = matchStats;
+  lastMatchStats.FinishMatch();
+  matchStats.Reset();
+  // Only matches the local player scored a stat in are known to be theirs
+  if (localPlayer != 0 && lastMatchStats.Get(localPlayer, games) != 0) {
+    lifetimeStats.Add(games);
+    if (matchStartNs != 0)
+      lifetimeStats.Add(timePlayed, (NowNs() - matchStartNs) / 1000000000);
+  }
+  lifetimeStats.Sync(NowNs(), false);
+  if (!showSummary)
+    return;
+  BL_LOG(BL_LOG_INFO, "Player exited, opening Nvidia summary.");
+  OpenSummary();
+}
+
+void HighlightCore::OnHotKey(HotKey key) {
+  if (capture.IsOpen())
+    capture.WriteHotKey(key, NowNs());
+  switch (key) {
+    case HotKey::OpenSummary:
+      BL_LOG(BL_LOG_INFO, "Player requested opening Nvidia summary.");
+      OpenSummary();
+      break;
+    case HotKey::PlayerEvent:
+      BL_LOG(BL_LOG_INFO, "Player requested custom recording.");
+      OnPlayerEvent();
+      break;
+    case HotKey::ClearHighlights:
+      BL_LOG(BL_LOG_INFO, "Player requested clearing highlights.");
+      ClearHighlights();
+      break;
+  }
+}
+
+void HighlightCore::OpenSummary() {
+  queue->OpenSummary(&GROUP1_ID, 1, SignificanceFilter(summaryTier),
+                     NVGSDK_HIGHLIGHT_TYPE_NONE);
+}
+
+void HighlightCore::ClearHighlights() {
+  queue->CloseGroup(GROUP1_ID, true);
+  queue->OpenGroup(GROUP1_ID);
+}
+
+void HighlightCore::OnRecordingTrigger(int slot) {
+  if (!enabled || slot == EventTable::kInvalidSlot)
+    return;
+
+  HighlightsDataHolder const& holder = events[slot];
+  char const* name = events.Name(slot).c_str();
+  // GFE would drop it after the round trip, and it should not use up the
+  // rate limits either
+  if (!queue->EventEnabled(slot)) {
+    disabledSkipped++;
+    BL_LOG(BL_LOG_TRACE, "Event disabled in GFE: %s", name);
+    return;
+  }
+  // Not worth the disk I/O, and should not use up the rate limits. The
+  // player's own captures are always kept.
+  int tier = scorer.Score(slot, context);
+  if (slot != playerEventSlot && tier < minTier) {
+    lowValueSkipped++;
+    BL_LOG(BL_LOG_TRACE, "Event below significance threshold: %s", name);
+    return;
+  }
+  // Same event repeating in a short interval, or GFE already getting enough requests
+  if (!admission->TryAdmit(slot, now())) {
+    BL_LOG(BL_LOG_TRACE, "Throttled event: %s", name);
+    return;
+  }
+  BL_LOG(BL_LOG_DEBUG, "Received event: %s - Will record [%dms/+%dms]", name,
+         holder.startDelta, holder.endDelta);
+
+  queue->SaveVideo(name, GROUP1_ID, holder.startDelta, holder.endDelta,
+                   holder.priority, tier);
+}
+
+void HighlightCore::HandleStatEvent(uintptr_t statEvent, uintptr_t pri) {
+  // The event name is only read the first time a StatEvent object is seen
+  int slot = statEventCache.Lookup(statEvent);
+  if (slot == StatEventCache::kUnresolved) {
+    std::string eventString = resolveName(statEvent);
+    slot = events.Find(eventString);
+    statEventCache.Insert(statEvent, slot);
+    if (capture.IsOpen() && capture.NeedsObject(statEvent))
+      capture.WriteObject(statEvent, eventString, NowNs());
+    if (slot == EventTable::kInvalidSlot) {
+      BL_LOG(BL_LOG_DEBUG, "Could not find config for event of type: %s",
+             eventString.c_str());
+    }
+  }
+  // Goals are scored for a team. Resolved before the event is captured, so
+  // the teams come first in the capture as well.
+  bool ownTeam = slot != EventTable::kInvalidSlot && scorer.Base(slot).goal &&
+                 OnLocalTeam(pri);
+  if (capture.IsOpen())
+    capture.WriteStatEvent(statEvent, pri, NowNs());
+  if (slot == EventTable::kInvalidSlot)
+    return;
+  BL_LOG(BL_LOG_DEBUG, "Found config for event of type: %s",
+         events.Name(slot).c_str());
+  // Before any highlight filter, the stats count what happened in the match
+  if (slotStats[slot] >= 0) {
+    matchStats.Record(pri, slotStats[slot]);
+    if (pri == localPlayer && pri != 0) {
+      lifetimeStats.Add(slotStats[slot]);
+      lifetimeStats.MaybeSync(NowNs());
+    }
+  }
+  // Compound highlights completed by this event share its team
+  context.ownTeam = ownTeam;
+  OnRecordingTrigger(slot);
+  int completed[RuleEngine::kMaxRules];
+  size_t numCompleted = rules.OnEvent(slot, pri, NowNs(), context.clock, completed);
+  for (size_t i = 0; i < numCompleted; i++) {
+    BL_LOG(BL_LOG_DEBUG, "Compound highlight: %s",
+           events.Name(completed[i]).c_str());
+    OnRecordingTrigger(completed[i]);
+  }
+}
+
+void HighlightCore::SetGameClock(int secondsRemaining, bool overtime) {
+  if (context.clock.known && context.clock.overtime == overtime &&
+      context.clock.secondsRemaining == secondsRemaining)
+    return;
+  context.clock = {true, overtime, secondsRemaining};
+  if (capture.IsOpen())
+    capture.WriteGameClock(secondsRemaining, overtime, NowNs());
+}
+
+void HighlightCore::SetScoreMargin(int margin) {
+  if (context.scoreKnown && context.scoreMargin == margin)
+    return;
+  context.scoreKnown = true;
+  context.scoreMargin = margin;
+  if (capture.IsOpen())
+    capture.WriteScoreMargin(true, margin, NowNs());
+}
+
+void HighlightCore::ClearScoreMargin() {
+  if (!context.scoreKnown)
+    return;
+  context.scoreKnown = false;
+  context.scoreMargin = 0;
+  if (capture.IsOpen())
+    capture.WriteScoreMargin(false, 0, NowNs());
+}
+
+void HighlightCore::SetLocalPlayer(uintptr_t pri) {
+  if (pri == localPlayer)
+    return;
+  localPlayer = pri;
+  if (capture.IsOpen())
+    capture.WriteLocalPlayer(pri, NowNs());
+}
+
+bool HighlightCore::OnLocalTeam(uintptr_t pri) {
+  if (pri == 0 || localPlayer == 0)
+    return false;
+  if (pri == localPlayer)
+    return true;
+  int team = TeamOf(pri);
+  return team >= 0 && team == TeamOf(localPlayer);
+}
+
+int HighlightCore::TeamOf(uintptr_t pri) {
+  if (!resolveTeam)
+    return -1;
+  int team = resolveTeam(pri);
+  if (capture.IsOpen())
+    capture.WritePlayerTeam(pri, team, NowNs());
+  return team;
+}
+
+bool HighlightCore::StartCapture(std::string const& path) {
+  if (!capture.Open(path, NowNs())) {
+    BL_LOG(BL_LOG_ERROR, "Could not open capture file %s", path.c_str());
+    return false;
+  }
+  // Objects resolved before the capture started would have no name in it
+  statEventCache.Clear();
+  // Scoring context of the match in progress
+  if (context.clock.known) {
+    capture.WriteGameClock(context.clock.secondsRemaining,
+                           context.clock.overtime, NowNs());
+  }
+  if (context.scoreKnown)
+    capture.WriteScoreMargin(true, context.scoreMargin, NowNs());
+  if (localPlayer != 0)
+    capture.WriteLocalPlayer(localPlayer, NowNs());
+  BL_LOG(BL_LOG_INFO, "Capturing events to %s", path.c_str());
+  return true;
+}
+
+size_t HighlightCore::StopCapture() {
+  size_t records = capture.Records();
+  capture.Close();
+  return records;
+}
+
+size_t HighlightCore::CountHotPathAllocations(int eventCount) {
+  int numSlots = static_cast<int>(events.size());
+  if (eventCount <= 0 || numSlots == 0)
+    return 0;
+
+  // Synthetic StatEvent objects, pre-resolved so the replay only exercises
+  // the steady state path. Commands go to a worker that is never started and
+  // rate limits are lifted, so every event goes all the way to the SDK queue.
+  std::vector<uintptr_t> objects(numSlots);
+  for (int slot = 0; slot < numSlots; slot++) {
+    objects[slot] = reinterpret_cast<uintptr_t>(&objects[slot]);
+    statEventCache.Insert(objects[slot], slot);
+  }
+  SdkWorker scratchQueue;
+  queue = &scratchQueue;
+  RateLimiter unlimited;
+  unlimited.Resize(numSlots);
+  admission = &unlimited;
+  bool wasEnabled = enabled;
+  enabled = true;
+  // Nothing is filtered by significance either, and the skips of the real
+  // match stay as they were
+  int savedMinTier = minTier;
+  minTier = kMinTier;
+  uint64_t savedLowValueSkipped = lowValueSkipped;
+  ScoreContext savedContext = context;
+  // Synthetic players fill the stat rows, the real ones come back afterwards
+  PlayerStatStore savedStats = matchStats;
+  matchStats.Reset();
+  RuleEngine savedRules = rules;
+  uintptr_t pris[PlayerStatStore::kMaxPlayers];
+  for (int i = 0; i < PlayerStatStore::kMaxPlayers; i++)
+    pris[i] = reinterpret_cast<uintptr_t>(&pris[i]);
+
+  size_t before = ThreadAllocationCount();
+  for (int i = 0; i < eventCount; i++) {
+    HandleStatEvent(objects[i % numSlots],
+                    pris[(i / numSlots) % PlayerStatStore::kMaxPlayers]);
+    if (i % 64 == 63)
+      scratchQueue.Discard();
+  }
+  size_t allocations = ThreadAllocationCount() - before;
+
+  queue = &worker;
+  admission = &limiter;
+  enabled = wasEnabled;
+  minTier = savedMinTier;
+  lowValueSkipped = savedLowValueSkipped;
+  context = savedContext;
+  matchStats = savedStats;
+  rules = savedRules;
+  statEventCache.Clear();
+  return allocations;
+}
@@ -0,0 +1,195 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ClipCoalescer.h"
+#include "CompoundRules.h"
+#include "EventCapture.h"
+#include "EventTable.h"
+#include "GfeSDKWrapper.h"
+#include "HighlightScore.h"
+#include "LifetimeStats.h"
+#include "PlayerStats.h"
+#include "RateLimiter.h"
+#include "SdkWorker.h"
+
+// Reads the event name of a StatEvent object. Only called the first time an
+// object is seen, see StatEventCache.
+using EventNameResolver = std::string (*)(uintptr_t statEvent);
+// Reads the team number of a PRI, negative when it has none. Only called for
+// goals, to tell the local team's from the other team's.
+using PlayerTeamResolver = int (*)(uintptr_t pri);
+// Time source of rate limiting and captures, replaced when replaying
+using CoreClock = RateLimiter::Clock::time_point (*)();
+
+extern char const* GROUP1_ID;
+
+// Fills the GFE highlight definitions for the events. Ids point into the table,
+// highlight i is event slot i.
+void BuildHighlightTable(EventTable const& events,
+                         std::vector<NVGSDK_Highlight>& highlights);
+
+// Event to highlight logic shared by the BakkesMod plugin and the Linux tools.
+// Owns the event table and its caches, the rate limits and the SDK worker, and
+// only reaches GFE through the GfeSdkWrapper, whose NVGSDK_* function table is
+// bound by the host: GfeSDK.dll in the plugin, FakeGfeSdk elsewhere.
+// Everything but the Stats accessors runs on the game thread.
+class HighlightCore {
+ public:
+  explicit HighlightCore(EventNameResolver resolveName);
+
+  // Builds the GFE highlight table and sizes the per event state
+  void LoadConfig();
+  // Returns without waiting for GFE. bind, when set, binds the NVGSDK_*
+  // functions on the SDK worker thread before Init.
+  void Start(std::string targetPath, int targetPid,
+             std::function<bool()> bind = nullptr);
+  void Stop();
+
+  // Keeps the local player's totals in a stat file from now on, see
+  // LifetimeStatStore
+  LifetimeStatsOpen OpenLifetimeStats(std::string const& path) {
+    return lifetimeStats.Open(path, NowNs());
+  }
+  void CloseLifetimeStats() { lifetimeStats.Close(); }
+  // PRI of the player whose stats go to the stat file
+  void SetLocalPlayer(uintptr_t pri);
+
+  void SetEnabled(bool value) { enabled = value; }
+  void SetClock(CoreClock clock) { now = clock; }
+  // Minimum interval between two captures of the same event
+  void SetEventDelay(double seconds);
+  void SetGlobalLimit(RateLimit limit);
+  // Overrides the event delay for one event, nullopt restores it. Returns false
+  // for unknown events.
+  bool SetEventLimit(std::string_view event, std::optional<RateLimit> limit);
+  void SetPollIntervals(std::chrono::milliseconds busy,
+                        std::chrono::milliseconds idle) {
+    worker.SetPollIntervals(busy, idle);
+  }
+  void SetCoalesceWindow(std::chrono::milliseconds window) {
+    worker.SetCoalesceWindow(window);
+  }
+  void SetReplayBuffer(std::chrono::seconds length) {
+    worker.SetReplayBuffer(length);
+  }
+  // Captures scored below this tier are not saved, see HighlightScorer
+  void SetMinSignificance(int tier) { minTier = tier; }
+  // The summary only shows highlights of this tier and above, kMinTier shows
+  // everything
+  void SetSummarySignificance(int tier) { summaryTier = tier; }
+
+  void OnMatchEnter(bool clearHighlights);
+  void OnMatchExit(bool showSummary);
+  void HandleStatEvent(uintptr_t statEvent, uintptr_t pri);
+  // Scoreboard clock of the following events, for compound highlights tied
+  // to the end of the match. Unknown until set each match.
+  void SetGameClock(int secondsRemaining, bool overtime);
+  // Local team's goals minus the other team's, for scoring the following
+  // events. Unknown until set each match, or again after ClearScoreMargin.
+  void SetScoreMargin(int margin);
+  void ClearScoreMargin();
+  // Without a resolver only the local player's own goals count as their team's
+  void SetTeamResolver(PlayerTeamResolver resolver) { resolveTeam = resolver; }
+  void OnHotKey(HotKey key);
+  // Manual capture requested by the player
+  void OnPlayerEvent() { OnRecordingTrigger(playerEventSlot); }
+  void OpenSummary();
+  // Deletes unsaved highlights and starts a fresh group
+  void ClearHighlights();
+  void OnRecordingTrigger(int slot);
+
+  // Records every input of the core to a capture file until StopCapture
+  bool StartCapture(std::string const& path);
+  // Returns the number of records written
+  size_t StopCapture();
+
+  // Replays synthetic stat events through the hot path and returns the number
+  // of heap allocations they caused
+  size_t CountHotPathAllocations(int events);
+
+  EventTable const& Events() const { return events; }
+  SdkWorkerStats WorkerStats() const { return worker.Stats(); }
+  SdkStartupState StartupState() const { return worker.StartupState(); }
+  // Of the worker's GFE session, kept readable after Stop
+  SdkCallStats CallStats(SdkCallType type) const { return worker.CallStats(type); }
+  SdkContextPoolStats ContextPoolStats() const { return worker.ContextPoolStats(); }
+  void Status(SdkStatus* status) const { worker.Status(status); }
+  size_t InFlight() const { return worker.InFlight(); }
+  SdkRequestTable const* Requests() const { return worker.Requests(); }
+  RateLimiter const& Limiter() const { return limiter; }
+  RuleEngine const& Rules() const { return rules; }
+  // Events not sent because the user turned their highlight off in GFE
+  uint64_t DisabledSkipped() const { return disabledSkipped; }
+  // Events not sent because they scored below the minimum significance
+  uint64_t LowValueSkipped() const { return lowValueSkipped; }
+  // Stats of every player in the current match, e.g.
+  // MatchStats().Get(pri, gameGoals). Counted whether or not the event made a
+  // highlight.
+  PlayerStatStore const& MatchStats() const { return matchStats; }
+  // Snapshot taken when the last match was left, games is 1 for its players
+  PlayerStatStore const& LastMatchStats() const { return lastMatchStats; }
+  LifetimeStatStore const& LifetimeStats() const { return lifetimeStats; }
+
+ private:
+  void ApplyRateLimits();
+  bool OnLocalTeam(uintptr_t pri);
+  // -1 when unknown
+  int TeamOf(uintptr_t pri);
+  int64_t NowNs() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               now().time_since_epoch())
+        .count();
+  }
+
+  EventNameResolver resolveName;
+  PlayerTeamResolver resolveTeam = nullptr;
+  CoreClock now = &RateLimiter::Clock::now;
+  bool enabled = true;
+  CaptureWriter capture;
+
+  std::string gameName = "Rocket League";
+  // TODO: Support user locale
+  std::string defaultLocale = "en-US";
+  // Their ids are slots of events, so they come first
+  std::vector<CompoundRule> compoundRules;
+  EventTable events;
+  std::vector<NVGSDK_Highlight> highlights;
+  int playerEventSlot = EventTable::kInvalidSlot;
+  StatEventCache statEventCache;
+  RuleEngine rules;
+  HighlightScorer scorer;
+  ScoreContext context = {};
+  int minTier = kMinTier;
+  int summaryTier = kMinTier;
+  // Stat counted by event slot i, -1 for none
+  std::vector<int> slotStats;
+  PlayerStatStore matchStats;
+  PlayerStatStore lastMatchStats;
+  LifetimeStatStore lifetimeStats;
+  uintptr_t localPlayer = 0;
+  int64_t matchStartNs = 0;
+
+  GfeSdkWrapper sdk;
+  SdkWorker worker;
+  // Where commands are queued, swapped out by the allocation self-check
+  SdkWorker* queue = &worker;
+
+  RateLimiter limiter;
+  // Admission control used by the hooks, swapped out by the allocation self-check
+  RateLimiter* admission = &limiter;
+  RateLimit eventDelay = RateLimit::Interval(3.0);
+  // Per event limits set from the console, overriding the event delay
+  std::vector<std::optional<RateLimit>> eventLimitOverrides;
+
+  uint64_t disabledSkipped = 0;
+  uint64_t lowValueSkipped = 0;
+
+  // Coalescer counters when the current match started
+  ClipCoalescerStats matchClipStats = {};
+};
@@ -0,0 +1,121 @@
+#include "HighlightScore.h"
+
+#include "GfeSDKWrapper.h"
+
+namespace {
+
+struct NamedScore {
+  std::string_view event;
+  EventScore score;
+};
+
+constexpr int kAchievement = NVGSDK_HIGHLIGHT_TYPE_ACHIEVEMENT;
+constexpr int kMilestone = NVGSDK_HIGHLIGHT_TYPE_MILESTONE;
+constexpr int kIncident = NVGSDK_HIGHLIGHT_TYPE_INCIDENT;
+constexpr int kStateChange = NVGSDK_HIGHLIGHT_TYPE_STATE_CHANGE;
+constexpr int kUnannounced = NVGSDK_HIGHLIGHT_TYPE_UNANNOUNCED;
+
+constexpr NamedScore kEventScores[] = {
+    {"AerialGoal", {3, kAchievement, true}},
+    {"Assist", {1, kAchievement, false}},
+    {"BackwardsGoal", {3, kAchievement, true}},
+    {"BicycleGoal", {3, kAchievement, true}},
+    {"BicycleHit", {1, kAchievement, false}},
+    {"BreakoutDamage", {0, kIncident, false}},
+    {"BreakoutDamageLarge", {1, kIncident, false}},
+    {"Center", {0, kAchievement, false}},
+    {"Clear", {0, kAchievement, false}},
+    {"DemoGoal", {2, kAchievement | kIncident, true}},
+    {"Demolish", {1, kIncident, false}},
+    {"Demolition", {1, kIncident, false}},
+    {"EpicSave", {2, kAchievement, false}},
+    {"FirstTouch", {0, kStateChange, false}},
+    {"Goal", {2, kAchievement, true}},
+    {"HatTrick", {3, kMilestone, true}},
+    {"HighFive", {0, kStateChange, false}},
+    {"HoopsSwishGoal", {3, kAchievement, true}},
+    {"LastSecondGoal", {3, kAchievement | kMilestone, true}},
+    {"LongGoal", {3, kAchievement, true}},
+    {"LowFive", {0, kStateChange, false}},
+    {"MVP", {2, kMilestone, false}},
+    {"OvertimeGoal", {3, kAchievement | kMilestone, true}},
+    {"OwnGoal", {-2, kIncident, false}},
+    {"PlayerEvent", {3, kUnannounced, false}},
+    {"Playmaker", {1, kAchievement, false}},
+    {"PoolShot", {3, kAchievement, true}},
+    {"Save", {1, kAchievement, false}},
+    {"Savior", {2, kAchievement, false}},
+    {"Shot", {0, kAchievement, false}},
+    {"TripleSave", {3, kAchievement, false}},
+    {"TurtleGoal", {3, kAchievement, true}},
+    {"Win", {2, kMilestone, false}},
+};
+
+int Clamp(int tier) {
+  return tier < kMinTier ? kMinTier : tier > kMaxTier ? kMaxTier : tier;
+}
+
+}  // namespace
+
+int SignificanceOfTier(int tier) {
+  switch (Clamp(tier)) {
+    case -3:
+      return NVGSDK_HIGHLIGHT_SIGNIFICANCE_EXTREMELY_BAD;
+    case -2:
+      return NVGSDK_HIGHLIGHT_SIGNIFICANCE_VERY_BAD;
+    case -1:
+      return NVGSDK_HIGHLIGHT_SIGNIFICANCE_BAD;
+    case 0:
+      return NVGSDK_HIGHLIGHT_SIGNIFICANCE_NEUTRAL;
+    case 1:
+      return NVGSDK_HIGHLIGHT_SIGNIFICANCE_GOOD;
+    case 2:
+      return NVGSDK_HIGHLIGHT_SIGNIFICANCE_VERY_GOOD;
+    default:
+      return NVGSDK_HIGHLIGHT_SIGNIFICANCE_EXTREMELY_GOOD;
+  }
+}
+
+int SignificanceFilter(int tier) {
+  if (tier <= kMinTier)
+    return NVGSDK_HIGHLIGHT_SIGNIFICANCE_NONE;
+  int filter = 0;
+  for (int t = tier; t <= kMaxTier; t++)
+    filter |= SignificanceOfTier(t);
+  return filter;
+}
+
+EventScore BaseEventScore(std::string_view event, int priority) {
+  for (NamedScore const& named : kEventScores) {
+    if (named.event == event)
+      return named.score;
+  }
+  int tier = priority >= 90 ? 3 : priority >= 60 ? 2 : priority >= 30 ? 1 : 0;
+  return {tier, NVGSDK_HIGHLIGHT_TYPE_NONE, false};
+}
+
+void HighlightScorer::Load(EventTable const& events) {
+  base.resize(events.size());
+  for (int slot = 0; slot < static_cast<int>(events.size()); slot++)
+    base[slot] = BaseEventScore(events.Name(slot), events[slot].priority);
+}
+
+int HighlightScorer::Score(int slot, ScoreContext const& context) const {
+  EventScore const& score = base[slot];
+  int tier = score.tier;
+  if (score.goal) {
+    GameClock const& clock = context.clock;
+    bool late = clock.known &&
+                (clock.overtime || clock.secondsRemaining <= kFinalSeconds);
+    // The margin is the one before the goal
+    bool close = context.scoreKnown && context.ownTeam &&
+                 context.scoreMargin >= -1 && context.scoreMargin <= 0;
+    if (late || close)
+      tier++;
+  }
+  if (context.scoreKnown && tier > 0 &&
+      (context.scoreMargin >= kBlowoutMargin ||
+       context.scoreMargin <= -kBlowoutMargin))
+    tier--;
+  return Clamp(tier);
+}
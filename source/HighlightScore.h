@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "CompoundRules.h"
+#include "EventTable.h"
+
+// Significance of a highlight as a tier from -3 (extremely bad) through 0
+// (neutral) to 3 (extremely good), one per NVGSDK_HighlightSignificance level
+constexpr int kMinTier = -3;
+constexpr int kMaxTier = 3;
+
+// NVGSDK_HighlightSignificance bit of a tier
+int SignificanceOfTier(int tier);
+// Summary filter showing tier and above, NONE (no filter) for kMinTier
+int SignificanceFilter(int tier);
+
+struct EventScore {
+  int tier;
+  // NVGSDK_HighlightType bits
+  int tags;
+  // Puts the ball in the net, weighs more late in a close match
+  bool goal;
+};
+
+// What GFE is told about an event type. Events without an entry of their own
+// are tiered by their capture priority.
+EventScore BaseEventScore(std::string_view event, int priority);
+
+// Match state at the time of a capture, set by the host before each event
+struct ScoreContext {
+  GameClock clock;
+  bool scoreKnown;
+  // The local player's team goals minus the other team's
+  int scoreMargin;
+  // The event is by the local player's team, only then can a goal close the
+  // margin
+  bool ownTeam;
+};
+
+// Tiers every capture from its event type and the match context. GFE only
+// knows the tier of each highlight definition, which filters the summary; the
+// tier of a capture decides whether it is worth saving at all.
+class HighlightScorer {
+ public:
+  static constexpr int kFinalSeconds = 30;
+  static constexpr int kBlowoutMargin = 4;
+
+  // Caches the base score of every slot
+  void Load(EventTable const& events);
+
+  EventScore const& Base(int slot) const { return base[slot]; }
+  // Goals late in regulation or in overtime, and the local team's goals that
+  // tie the match or take the lead, go up one tier. Anything in a blowout goes
+  // down one.
+  int Score(int slot, ScoreContext const& context) const;
+
+ private:
+  std::vector<EventScore> base;
+};
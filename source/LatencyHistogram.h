@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear latency histogram with microsecond resolution, in the manner of
+// HdrHistogram. Every power of two range is split into 16 linear sub-buckets,
+// which bounds the relative error of a percentile to 6.25% over a range of
+// 1us to an hour in 4KB. Recording is wait-free; readers may run on any thread.
+class LatencyHistogram {
+ public:
+  void Record(uint64_t latencyNs) {
+    uint64_t us = latencyNs / 1000;
+    buckets[BucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalNs.fetch_add(latencyNs, std::memory_order_relaxed);
+    if (latencyNs > maxNs.load(std::memory_order_relaxed))
+      maxNs.store(latencyNs, std::memory_order_relaxed);
+  }
+
+  uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+
+  double MeanUs() const {
+    uint64_t n = Count();
+    return n ? totalNs.load(std::memory_order_relaxed) / 1000.0 / n : 0.0;
+  }
+
+  double MaxUs() const { return maxNs.load(std::memory_order_relaxed) / 1000.0; }
+
+  // Upper bound of the bucket holding the given percentile (0-100), capped at
+  // the largest value recorded
+  double PercentileUs(double percentile) const {
+    uint64_t n = Count();
+    if (n == 0)
+      return 0.0;
+    uint64_t rank = static_cast<uint64_t>(n * percentile / 100.0);
+    if (rank >= n)
+      rank = n - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+      seen += buckets[i].load(std::memory_order_relaxed);
+      if (seen > rank)
+        return std::min(static_cast<double>(UpperBoundOf(i)), MaxUs());
+    }
+    return MaxUs();
+  }
+
+  void Reset() {
+    for (auto& bucket : buckets)
+      bucket.store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    totalNs.store(0, std::memory_order_relaxed);
+    maxNs.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr size_t kSubBucketBits = 4;
+  static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+  // Covers up to 2^32 us (over an hour), larger values land in the last bucket
+  static constexpr size_t kBuckets =
+      kSubBuckets + (32 - kSubBucketBits) * kSubBuckets;
+
+  static size_t BucketOf(uint64_t us) {
+    if (us < kSubBuckets)
+      return static_cast<size_t>(us);
+    size_t exponent = 63;
+    while (!(us >> exponent))
+      --exponent;
+    size_t shift = exponent - kSubBucketBits;
+    size_t sub = static_cast<size_t>(us >> shift) & (kSubBuckets - 1);
+    size_t index = kSubBuckets + shift * kSubBuckets + sub;
+    return index < kBuckets ? index : kBuckets - 1;
+  }
+
+  static uint64_t UpperBoundOf(size_t index) {
+    if (index < kSubBuckets)
+      return index + 1;
+    size_t shift = (index - kSubBuckets) / kSubBuckets;
+    size_t sub = (index - kSubBuckets) % kSubBuckets;
+    return (static_cast<uint64_t>(kSubBuckets + sub + 1) << shift);
+  }
+
+  std::atomic<uint64_t> buckets[kBuckets] = {};
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> totalNs{0};
+  std::atomic<uint64_t> maxNs{0};
+};
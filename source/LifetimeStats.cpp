@@ -0,0 +1,301 @@
+#include "LifetimeStats.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Log.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'B', 'L', 'S', 'T', 'A', 'T', 'S', 0};
+constexpr uint32_t kVersion = 1;
+
+// Word layout of a block: generation of the newest checkpoint, sessions, then
+// the lifetime and the session counters
+constexpr size_t kGeneration = 0;
+constexpr size_t kSessions = 1;
+constexpr size_t kLifetime = 2;
+constexpr size_t kSession = kLifetime + LifetimeStatStore::kMaxStats;
+constexpr size_t kWords = kSession + LifetimeStatStore::kMaxStats;
+// So that a block of zeros, e.g. a page that never made it to the disk, does
+// not pass as empty
+constexpr uint64_t kChecksumSeed = 0x424C535441545331;
+
+static_assert(numStats <= LifetimeStatStore::kMaxStats,
+              "the stat file has no room for every stat");
+
+struct Block {
+  uint64_t checksum;
+  uint64_t words[kWords];
+};
+
+// Odd weights, so a torn block whose words moved between old and new values
+// rarely keeps its sum. Not meant to stop anyone editing the file.
+uint64_t Weight(size_t word) {
+  return 2 * word + 1;
+}
+
+uint64_t Checksum(Block const& block) {
+  uint64_t sum = kChecksumSeed;
+  for (size_t i = 0; i < kWords; ++i)
+    sum += block.words[i] * Weight(i);
+  return sum;
+}
+
+bool Valid(Block const& block) {
+  return block.checksum == Checksum(block);
+}
+
+void AddWord(Block& block, size_t word, uint64_t delta) {
+  block.words[word] += delta;
+  block.checksum += delta * Weight(word);
+}
+
+void Clear(Block& block) {
+  std::memset(&block, 0, sizeof(block));
+  block.checksum = Checksum(block);
+}
+
+}  // namespace
+
+struct LifetimeStatStore::File {
+  char magic[8];
+  uint32_t version;
+  // Stats in use, numStats of the newest plugin that opened the file
+  uint32_t numStats;
+  uint32_t blockWords;
+  uint32_t reserved;
+  Block live;
+  Block checkpoints[2];
+};
+
+struct LifetimeStatStore::Mapping {
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE mapping;
+#else
+  int fd;
+#endif
+};
+
+char const* LifetimeStatsOpenName(LifetimeStatsOpen result) {
+  switch (result) {
+    case LifetimeStatsOpen::Closed:
+      return "closed";
+    case LifetimeStatsOpen::Failed:
+      return "failed";
+    case LifetimeStatsOpen::Created:
+      return "created";
+    case LifetimeStatsOpen::Live:
+      return "live";
+    case LifetimeStatsOpen::Checkpoint:
+      return "restored from checkpoint";
+    case LifetimeStatsOpen::Reset:
+      return "reset";
+  }
+  return "unknown";
+}
+
+LifetimeStatsOpen LifetimeStatStore::Open(std::string const& path,
+                                          int64_t nowNs) {
+  Close();
+  if (!Map(path)) {
+    BL_LOG(BL_LOG_ERROR, "Could not map stat file %s", path.c_str());
+    openResult = LifetimeStatsOpen::Failed;
+    return openResult;
+  }
+
+  File& f = *view;
+  bool known = std::memcmp(f.magic, kMagic, sizeof(kMagic)) == 0 &&
+               f.version == kVersion && f.blockWords == kWords;
+  // A header of zeros, as the OS leaves a file it just created or extended
+  static constexpr char kNoMagic[sizeof(kMagic)] = {};
+  bool created = std::memcmp(f.magic, kNoMagic, sizeof(kNoMagic)) == 0 &&
+                 f.version == 0 && f.numStats == 0 && f.blockWords == 0;
+  if (!known && !created) {
+    // Another format, or not a stat file at all. Wiping it would lose
+    // whatever a newer plugin counted.
+    BL_LOG(BL_LOG_ERROR, "Stat file %s has format %u, expected %u, leaving it alone",
+           path.c_str(), f.version, kVersion);
+    Unmap();
+    openResult = LifetimeStatsOpen::Failed;
+    return openResult;
+  }
+  if (!known) {
+    // New file, the OS zero fills it
+    std::memset(&f, 0, sizeof(f));
+    std::memcpy(f.magic, kMagic, sizeof(kMagic));
+    f.version = kVersion;
+    f.blockWords = kWords;
+    Clear(f.live);
+    Clear(f.checkpoints[0]);
+    Clear(f.checkpoints[1]);
+    openResult = LifetimeStatsOpen::Created;
+  }
+  else if (Valid(f.live)) {
+    openResult = LifetimeStatsOpen::Live;
+  }
+  else {
+    Block const* newest = nullptr;
+    for (Block const& checkpoint : f.checkpoints) {
+      if (Valid(checkpoint) &&
+          (!newest || checkpoint.words[kGeneration] > newest->words[kGeneration]))
+        newest = &checkpoint;
+    }
+    if (newest) {
+      f.live = *newest;
+      openResult = LifetimeStatsOpen::Checkpoint;
+    }
+    else {
+      Clear(f.live);
+      Clear(f.checkpoints[0]);
+      Clear(f.checkpoints[1]);
+      openResult = LifetimeStatsOpen::Reset;
+    }
+  }
+  // Stats added to Maps.h since start at zero, the file has room for them
+  if (f.numStats < static_cast<uint32_t>(numStats))
+    f.numStats = numStats;
+
+  for (size_t i = kSession; i < kWords; ++i)
+    AddWord(f.live, i, 0 - f.live.words[i]);
+  AddWord(f.live, kSessions, 1);
+  Sync(nowNs, false);
+  BL_LOG(BL_LOG_INFO, "Stat file %s %s, session %llu", path.c_str(),
+         LifetimeStatsOpenName(openResult),
+         (unsigned long long)f.live.words[kSessions]);
+  return openResult;
+}
+
+void LifetimeStatStore::Close() {
+  if (!IsOpen())
+    return;
+  if (dirty)
+    Sync(lastSyncNs, true);
+  else
+    Flush(true);
+  Unmap();
+  openResult = LifetimeStatsOpen::Closed;
+}
+
+void LifetimeStatStore::Add(int stat, uint64_t count) {
+  if (!view || stat < 0 || stat >= numStats)
+    return;
+  AddWord(view->live, kLifetime + stat, count);
+  AddWord(view->live, kSession + stat, count);
+  dirty = true;
+}
+
+void LifetimeStatStore::Sync(int64_t nowNs, bool wait) {
+  if (!view)
+    return;
+  Block& live = view->live;
+  AddWord(live, kGeneration, 1);
+  // The other checkpoint stays intact should this one be torn
+  view->checkpoints[live.words[kGeneration] & 1] = live;
+  Flush(wait);
+  dirty = false;
+  lastSyncNs = nowNs;
+  syncs++;
+}
+
+uint64_t LifetimeStatStore::Lifetime(int stat) const {
+  if (!view || stat < 0 || stat >= numStats)
+    return 0;
+  return view->live.words[kLifetime + stat];
+}
+
+uint64_t LifetimeStatStore::Session(int stat) const {
+  if (!view || stat < 0 || stat >= numStats)
+    return 0;
+  return view->live.words[kSession + stat];
+}
+
+uint64_t LifetimeStatStore::Sessions() const {
+  return view ? view->live.words[kSessions] : 0;
+}
+
+#ifdef _WIN32
+
+bool LifetimeStatStore::Map(std::string const& path) {
+  HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE)
+    return false;
+  // Extends a new or short file, a longer one keeps its tail
+  HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READWRITE, 0,
+                                      sizeof(File), nullptr);
+  void* address = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+                                          sizeof(File))
+                          : nullptr;
+  if (!address) {
+    if (mapping)
+      CloseHandle(mapping);
+    CloseHandle(handle);
+    return false;
+  }
+  file = new Mapping{handle, mapping};
+  view = static_cast<File*>(address);
+  return true;
+}
+
+void LifetimeStatStore::Unmap() {
+  UnmapViewOfFile(view);
+  CloseHandle(file->mapping);
+  CloseHandle(file->file);
+  delete file;
+  file = nullptr;
+  view = nullptr;
+}
+
+void LifetimeStatStore::Flush(bool wait) {
+  FlushViewOfFile(view, sizeof(File));
+  if (wait)
+    FlushFileBuffers(file->file);
+}
+
+#else
+
+bool LifetimeStatStore::Map(std::string const& path) {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      (info.st_size < static_cast<off_t>(sizeof(File)) &&
+       ftruncate(fd, sizeof(File)) != 0)) {
+    close(fd);
+    return false;
+  }
+  void* address = mmap(nullptr, sizeof(File), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+  if (address == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  file = new Mapping{fd};
+  view = static_cast<File*>(address);
+  return true;
+}
+
+void LifetimeStatStore::Unmap() {
+  munmap(view, sizeof(File));
+  close(file->fd);
+  delete file;
+  file = nullptr;
+  view = nullptr;
+}
+
+void LifetimeStatStore::Flush(bool wait) {
+  msync(view, sizeof(File), wait ? MS_SYNC : MS_ASYNC);
+}
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Maps.h"
+
+// How Open found the stat file
+enum class LifetimeStatsOpen : uint8_t {
+  Closed,
+  // Could not be created or mapped, or of a format this build cannot read,
+  // e.g. written by a newer plugin. The file is left as it was.
+  Failed,
+  // No file yet, counting from zero
+  Created,
+  // Live counters matched their checksum
+  Live,
+  // Live counters were torn, e.g. by a power loss before every page reached
+  // the disk, and were restored from the newest checkpoint
+  Checkpoint,
+  // Nothing in the file could be trusted, counting from zero
+  Reset,
+};
+
+char const* LifetimeStatsOpenName(LifetimeStatsOpen result);
+
+// Lifetime and per session totals of the local player's stats, indexed by the
+// `stats` of Maps.h and kept in a memory mapped file of fixed layout:
+//   header       magic "BLSTATS", format version, stat count
+//   live         counters Add updates in place, with their checksum
+//   checkpoints  two copies of live written alternately by Sync, each with a
+//                generation and a checksum
+// Add is two plain stores into the mapping, counter and checksum, so a crash
+// of the game loses nothing the OS already has. Sync copies live into the
+// older checkpoint and asks the OS to write the pages back; when live does not
+// match its checksum on the next Open, the newest valid checkpoint is used.
+// The file never grows, so Open costs the same however long it was kept.
+// Game thread only.
+class LifetimeStatStore {
+ public:
+  // Room in the file, numStats may grow up to this without a new format
+  static constexpr int kMaxStats = 96;
+  static constexpr int64_t kDefaultSyncIntervalNs = 30000000000;
+
+  LifetimeStatStore() = default;
+  ~LifetimeStatStore() { Close(); }
+  LifetimeStatStore(LifetimeStatStore const&) = delete;
+  LifetimeStatStore& operator=(LifetimeStatStore const&) = delete;
+
+  // Maps the file, creating it when missing, and starts a new session
+  LifetimeStatsOpen Open(std::string const& path, int64_t nowNs);
+  // Syncs and waits for the pages to reach the disk, then unmaps the file
+  void Close();
+  bool IsOpen() const { return file != nullptr; }
+  LifetimeStatsOpen OpenResult() const { return openResult; }
+
+  void Add(int stat, uint64_t count = 1);
+  // Checkpoints the counters when they changed at least the sync interval
+  // after the last checkpoint
+  void MaybeSync(int64_t nowNs) {
+    if (dirty && nowNs - lastSyncNs >= syncIntervalNs)
+      Sync(nowNs, false);
+  }
+  // Checkpoints the counters and starts writing them back, wait blocks until
+  // they are on the disk
+  void Sync(int64_t nowNs, bool wait);
+  void SetSyncInterval(int64_t ns) { syncIntervalNs = ns; }
+
+  // Zero when the store is closed
+  uint64_t Lifetime(int stat) const;
+  uint64_t Session(int stat) const;
+  // Plugin loads counted by the file, this one included
+  uint64_t Sessions() const;
+  uint64_t Syncs() const { return syncs; }
+
+ private:
+  struct File;
+  struct Mapping;
+
+  bool Map(std::string const& path);
+  void Unmap();
+  void Flush(bool wait);
+
+  Mapping* file = nullptr;
+  File* view = nullptr;
+  LifetimeStatsOpen openResult = LifetimeStatsOpen::Closed;
+  bool dirty = false;
+  int64_t lastSyncNs = 0;
+  int64_t syncIntervalNs = kDefaultSyncIntervalNs;
+  uint64_t syncs = 0;
+};
@@ -0,0 +1,116 @@
+#include "Log.h"
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <thread>
+#include "MpscRing.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+std::atomic<int> g_logLevel{BL_LOG_INFO};
+
+namespace {
+
+constexpr size_t kRecordCapacity = 256;
+constexpr size_t kRecordTextSize = 240;
+
+struct LogRecord {
+  BL_LogLevel level;
+  char text[kRecordTextSize];
+};
+
+MpscRing<LogRecord, kRecordCapacity> g_ring;
+std::atomic<size_t> g_dropped{0};
+std::thread g_flusher;
+std::atomic<bool> g_running{false};
+LogSinkFn g_sink = nullptr;
+void* g_sinkContext = nullptr;
+size_t g_reportedDrops = 0;
+
+void Emit(BL_LogLevel level, char const* text) {
+#ifdef _WIN32
+  OutputDebugStringA(text);
+  OutputDebugStringA("\n");
+#else
+  std::fprintf(stderr, "%s\n", text);
+#endif
+  if (g_sink)
+    g_sink(level, text, g_sinkContext);
+}
+
+size_t FlushPending() {
+  size_t count = g_ring.Drain(
+      [](LogRecord const& record) { Emit(record.level, record.text); });
+  size_t dropped = g_dropped.load(std::memory_order_relaxed);
+  if (dropped != g_reportedDrops) {
+    char line[64];
+    std::snprintf(line, sizeof(line), "Log ring full, dropped %zu records",
+                  dropped - g_reportedDrops);
+    g_reportedDrops = dropped;
+    Emit(BL_LOG_ERROR, line);
+  }
+  return count;
+}
+
+void FlusherMain() {
+  while (g_running.load(std::memory_order_acquire)) {
+    if (FlushPending() == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  FlushPending();
+}
+
+}  // namespace
+
+void LogSetLevel(int level) {
+  if (level < BL_LOG_OFF)
+    level = BL_LOG_OFF;
+  if (level > BL_LOG_TRACE)
+    level = BL_LOG_TRACE;
+  g_logLevel.store(level, std::memory_order_relaxed);
+}
+
+int LogLevel(void) {
+  return BL_LOG_LEVEL();
+}
+
+void LogSetSink(LogSinkFn sink, void* context) {
+  g_sink = sink;
+  g_sinkContext = context;
+}
+
+void LogStart(void) {
+  if (g_running.exchange(true))
+    return;
+  g_flusher = std::thread(&FlusherMain);
+}
+
+void LogStop(void) {
+  if (!g_running.exchange(false))
+    return;
+  g_flusher.join();
+}
+
+size_t LogFlush(void) {
+  return FlushPending();
+}
+
+void LogWrite(BL_LogLevel level, char const* fmt, ...) {
+  if (!BL_LOG_ENABLED(level))
+    return;
+  size_t pos;
+  LogRecord* record = g_ring.Claim(pos);
+  if (!record) {
+    g_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  std::vsnprintf(record->text, kRecordTextSize, fmt, args);
+  va_end(args);
+  record->level = level;
+  g_ring.Publish(pos);
+}
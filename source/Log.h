@@ -0,0 +1,62 @@
+#pragma once
+#include <stddef.h>
+
+#ifdef __cplusplus
+#include <atomic>
+
+extern "C" {
+#endif
+
+typedef enum {
+  BL_LOG_OFF = 0,
+  BL_LOG_ERROR = 1,
+  BL_LOG_INFO = 2,
+  BL_LOG_DEBUG = 3,
+  BL_LOG_TRACE = 4
+} BL_LogLevel;
+
+// Receives flushed records on the flusher thread, or on the thread calling
+// LogFlush
+typedef void (*LogSinkFn)(BL_LogLevel level, char const* text, void* context);
+
+void LogSetLevel(int level);
+// For C callers, C++ ones read g_logLevel directly
+int LogLevel(void);
+// Must be set before LogStart
+void LogSetSink(LogSinkFn sink, void* context);
+// Starts the background flusher. Records written before this are kept.
+void LogStart(void);
+// Drains pending records and joins the flusher
+void LogStop(void);
+// Drains pending records into the sink on the calling thread and returns how
+// many. For hosts whose sink must run on one thread, e.g. the game thread:
+// they call this periodically instead of starting the flusher.
+size_t LogFlush(void);
+
+// Formats a record straight into the ring. Never blocks: when the ring is full
+// the record is dropped and counted.
+void LogWrite(BL_LogLevel level, char const* fmt, ...);
+
+#ifdef __cplusplus
+}
+
+// Current level, a relaxed load so a disabled call site costs a single load
+// and compare
+extern std::atomic<int> g_logLevel;
+#define BL_LOG_LEVEL() g_logLevel.load(std::memory_order_relaxed)
+
+extern "C" {
+#else
+#define BL_LOG_LEVEL() LogLevel()
+#endif
+
+#define BL_LOG_ENABLED(level) ((int)(level) <= BL_LOG_LEVEL())
+#define BL_LOG(level, ...)          \
+  do {                              \
+    if (BL_LOG_ENABLED(level))      \
+      LogWrite((level), __VA_ARGS__); \
+  } while (0)
+
+#ifdef __cplusplus
+}
+#endif
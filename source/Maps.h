@@ -1,12 +1,10 @@
 #pragma once
-#include <string>
-#include <vector>
-#include <functional>
-#include <memory>
-#include <map>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
 // enum for all stat indexes
 // easier to refer back to stat names
-// total stats are from 0 to 30, game stats from 31 to end
+// total stats are from 0 to 34, game stats from 35 to end
 enum stats {
   wins,
   losses,
@@ -14,7 +12,7 @@ enum stats {
   games,
   // end of stats without game counterpart
   statsWithoutGame = games,
-  // stat + 27 = gameStat
+  // stat + totalToGame = gameStat
   goals,
   demos,
   deaths,
@@ -48,8 +46,8 @@ enum stats {
   timePlayed,
   offenseTime,
   defenseTime,
-  // game stats are from 31 -> end
-  // goals + 27 = gameGoals
+  // game stats are from 35 -> end
+  // goals + totalToGame = gameGoals
   gameGoals,
   // start of game stats and/or 1 after the end of non-game stats
   startGameStats = gameGoals,
@@ -88,204 +86,339 @@ enum stats {
   numStats
 };
 
-// jump from a stat to its most recent game stat by adding this number (27)
-// goals + 27 = gameGoals
+// jump from a stat to its most recent game stat by adding this number (31)
+// goals + totalToGame = gameGoals
 constexpr int totalToGame = startGameStats - 1 - statsWithoutGame;
 
-std::string indexStringMap[] = {"wins",
-                                "losses",
-                                "mvps",
-                                "games",
-                                "goals",
-                                "demolitions",
-                                "deaths",
-                                "exterminations",
-                                "aerialGoals",
-                                "backwardsGoals",
-                                "bicycleGoals",
-                                "longGoals",
-                                "turtleGoals",
-                                "poolShots",
-                                "overtimeGoals",
-                                "hatTricks",
-                                "assists",
-                                "playmakers",
-                                "saves",
-                                "epicSaves",
-                                "saviors",
-                                "shots",
-                                "centers",
-                                "clears",
-                                "firstTouchs",
-                                "damages",
-                                "ultraDamages",
-                                "lowFives",
-                                "highFives",
-                                "swishs",
-                                "bicycleHits",
-                                "points",
-                                "timePlayed",
-                                "offenseTime",
-                                "defenseTime",
-                                "gameGoals",
-                                "gameDemolitions",
-                                "gameDeaths",
-                                "gameExterminations",
-                                "gameAerialGoals",
-                                "gameBackwardsGoals",
-                                "gameBicycleGoals",
-                                "gameLongGoals",
-                                "gameTurtleGoals",
-                                "gamePoolShots",
-                                "gameOvertimeGoals",
-                                "gameHatTricks",
-                                "gameAssists",
-                                "gamePlaymakers",
-                                "gameSaves",
-                                "gameEpicSaves",
-                                "gameSaviors",
-                                "gameShots",
-                                "gameCenters",
-                                "gameClears",
-                                "gameFirstTouchs",
-                                "gameDamages",
-                                "gameUltraDamages",
-                                "gameLowFives",
-                                "gameHighFives",
-                                "gameSwishs",
-                                "gameBicycleHits",
-                                "gamePoints",
-                                "gameTimePlayed",
-                                "gameOffenseTime",
-                                "gameDefenseTime"};
+// Names of the stats by index. constexpr string_views live once in the
+// binary's read-only data and need no initialization at load.
+inline constexpr std::string_view indexStringMap[] = {
+    "wins",
+    "losses",
+    "mvps",
+    "games",
+    "goals",
+    "demolitions",
+    "deaths",
+    "exterminations",
+    "aerialGoals",
+    "backwardsGoals",
+    "bicycleGoals",
+    "longGoals",
+    "turtleGoals",
+    "poolShots",
+    "overtimeGoals",
+    "hatTricks",
+    "assists",
+    "playmakers",
+    "saves",
+    "epicSaves",
+    "saviors",
+    "shots",
+    "centers",
+    "clears",
+    "firstTouchs",
+    "damages",
+    "ultraDamages",
+    "lowFives",
+    "highFives",
+    "swishs",
+    "bicycleHits",
+    "points",
+    "timePlayed",
+    "offenseTime",
+    "defenseTime",
+    "gameGoals",
+    "gameDemolitions",
+    "gameDeaths",
+    "gameExterminations",
+    "gameAerialGoals",
+    "gameBackwardsGoals",
+    "gameBicycleGoals",
+    "gameLongGoals",
+    "gameTurtleGoals",
+    "gamePoolShots",
+    "gameOvertimeGoals",
+    "gameHatTricks",
+    "gameAssists",
+    "gamePlaymakers",
+    "gameSaves",
+    "gameEpicSaves",
+    "gameSaviors",
+    "gameShots",
+    "gameCenters",
+    "gameClears",
+    "gameFirstTouchs",
+    "gameDamages",
+    "gameUltraDamages",
+    "gameLowFives",
+    "gameHighFives",
+    "gameSwishs",
+    "gameBicycleHits",
+    "gamePoints",
+    "gameTimePlayed",
+    "gameOffenseTime",
+    "gameDefenseTime",
+};
 
-std::string indexStringMapRender[numStats] = {"Wins: ",
-                                              "Losses: ",
-                                              "Mvps: ",
-                                              "Games: ",
-                                              "Goals: ",
-                                              "Demolitions: ",
-                                              "Deaths: ",
-                                              "Exterminations: ",
-                                              "AerialGoals: ",
-                                              "BackwardsGoals: ",
-                                              "BicycleGoals: ",
-                                              "LongGoals: ",
-                                              "TurtleGoals: ",
-                                              "PoolShots: ",
-                                              "OvertimeGoals: ",
-                                              "HatTricks: ",
-                                              "Assists: ",
-                                              "Playmakers: ",
-                                              "Saves: ",
-                                              "EpicSaves: ",
-                                              "Saviors: ",
-                                              "Shots: ",
-                                              "Centers: ",
-                                              "Clears: ",
-                                              "FirstTouchs: ",
-                                              "Damages: ",
-                                              "UltraDamages: ",
-                                              "LowFives: ",
-                                              "HighFives: ",
-                                              "Swishs: ",
-                                              "BicycleHits: ",
-                                              "Points: ",
-                                              "TimePlayed: ",
-                                              "OffenseTime: ",
-                                              "DefenseTime: ",
-                                              "GameGoals: ",
-                                              "GameDemolitions: ",
-                                              "GameDeaths: ",
-                                              "GameExterminations: ",
-                                              "GameAerialGoals: ",
-                                              "GameBackwardsGoals: ",
-                                              "GameBicycleGoals: ",
-                                              "GameLongGoals: ",
-                                              "GameTurtleGoals: ",
-                                              "GamePoolShots: ",
-                                              "GameOvertimeGoals: ",
-                                              "GameHatTricks: ",
-                                              "GameAssists: ",
-                                              "GamePlaymakers: ",
-                                              "GameSaves: ",
-                                              "GameEpicSaves: ",
-                                              "GameSaviors: ",
-                                              "GameShots: ",
-                                              "GameCenters: ",
-                                              "GameClears: ",
-                                              "GameFirstTouchs: ",
-                                              "GameDamages: ",
-                                              "GameUltraDamages: ",
-                                              "GameLowFives: ",
-                                              "GameHighFives: ",
-                                              "GameSwishs: ",
-                                              "GameBicycleHits: ",
-                                              "GamePoints: ",
-                                              "GameTimePlayed: ",
-                                              "GameOffenseTime: ",
-                                              "GameDefenseTime: "};
+inline constexpr std::string_view indexStringMapRender[] = {
+    "Wins: ",
+    "Losses: ",
+    "Mvps: ",
+    "Games: ",
+    "Goals: ",
+    "Demolitions: ",
+    "Deaths: ",
+    "Exterminations: ",
+    "AerialGoals: ",
+    "BackwardsGoals: ",
+    "BicycleGoals: ",
+    "LongGoals: ",
+    "TurtleGoals: ",
+    "PoolShots: ",
+    "OvertimeGoals: ",
+    "HatTricks: ",
+    "Assists: ",
+    "Playmakers: ",
+    "Saves: ",
+    "EpicSaves: ",
+    "Saviors: ",
+    "Shots: ",
+    "Centers: ",
+    "Clears: ",
+    "FirstTouchs: ",
+    "Damages: ",
+    "UltraDamages: ",
+    "LowFives: ",
+    "HighFives: ",
+    "Swishs: ",
+    "BicycleHits: ",
+    "Points: ",
+    "TimePlayed: ",
+    "OffenseTime: ",
+    "DefenseTime: ",
+    "GameGoals: ",
+    "GameDemolitions: ",
+    "GameDeaths: ",
+    "GameExterminations: ",
+    "GameAerialGoals: ",
+    "GameBackwardsGoals: ",
+    "GameBicycleGoals: ",
+    "GameLongGoals: ",
+    "GameTurtleGoals: ",
+    "GamePoolShots: ",
+    "GameOvertimeGoals: ",
+    "GameHatTricks: ",
+    "GameAssists: ",
+    "GamePlaymakers: ",
+    "GameSaves: ",
+    "GameEpicSaves: ",
+    "GameSaviors: ",
+    "GameShots: ",
+    "GameCenters: ",
+    "GameClears: ",
+    "GameFirstTouchs: ",
+    "GameDamages: ",
+    "GameUltraDamages: ",
+    "GameLowFives: ",
+    "GameHighFives: ",
+    "GameSwishs: ",
+    "GameBicycleHits: ",
+    "GamePoints: ",
+    "GameTimePlayed: ",
+    "GameOffenseTime: ",
+    "GameDefenseTime: ",
+};
 
-std::string averageStrings[startGameStats] = {
-    "averageWins",           "averageLosses",         "averageMvps",
-    "averageGames",          "averageGoals",          "averageDemolitions",
-    "averageDeaths",         "averageExterminations", "averageAerialGoals",
-    "averageBackwardsGoals", "averageBicycleGoals",   "averageLongGoals",
-    "averageTurtleGoals",    "averagePoolShots",      "averageOvertimeGoals",
-    "averageHatTricks",      "averageAssists",        "averagePlaymakers",
-    "averageSaves",          "averageEpicSaves",      "averageSaviors",
-    "averageShots",          "averageCenters",        "averageClears",
-    "averageFirstTouchs",    "averageDamages",        "averageUltraDamages",
-    "averageLowFives",       "averageHighFives",      "averageSwishs",
-    "averageBicycleHits",    "averagePoints",         "averageTimePlayed",
-    "averageOffenseTime",    "averageDefenseTime"};
+// Averages of the stats before the game stats
+inline constexpr std::string_view averageStrings[] = {
+    "averageWins",
+    "averageLosses",
+    "averageMvps",
+    "averageGames",
+    "averageGoals",
+    "averageDemolitions",
+    "averageDeaths",
+    "averageExterminations",
+    "averageAerialGoals",
+    "averageBackwardsGoals",
+    "averageBicycleGoals",
+    "averageLongGoals",
+    "averageTurtleGoals",
+    "averagePoolShots",
+    "averageOvertimeGoals",
+    "averageHatTricks",
+    "averageAssists",
+    "averagePlaymakers",
+    "averageSaves",
+    "averageEpicSaves",
+    "averageSaviors",
+    "averageShots",
+    "averageCenters",
+    "averageClears",
+    "averageFirstTouchs",
+    "averageDamages",
+    "averageUltraDamages",
+    "averageLowFives",
+    "averageHighFives",
+    "averageSwishs",
+    "averageBicycleHits",
+    "averagePoints",
+    "averageTimePlayed",
+    "averageOffenseTime",
+    "averageDefenseTime",
+};
 
-std::string averageStringsRender[] = {
-    "AverageWins: ",          "AverageLosses: ",
-    "AverageMvps: ",          "AverageGames: ",
-    "AverageGoals: ",         "AverageDemolitions: ",
-    "AverageDeaths: ",        "AverageExterminations: ",
-    "AverageAerialGoals: ",   "AverageBackwardsGoals: ",
-    "AverageBicycleGoals: ",  "AverageLongGoals: ",
-    "AverageTurtleGoals: ",   "AveragePoolShots: ",
-    "AverageOvertimeGoals: ", "AverageHatTricks: ",
-    "AverageAssists: ",       "AveragePlaymakers: ",
-    "AverageSaves: ",         "AverageEpicSaves: ",
-    "AverageSaviors: ",       "AverageShots: ",
-    "AverageCenters: ",       "AverageClears: ",
-    "AverageFirstTouchs: ",   "AverageDamages: ",
-    "AverageUltraDamages: ",  "AverageLowFives: ",
-    "AverageHighFives: ",     "AverageSwishs: ",
-    "AverageBicycleHits: ",   "AveragePoints: ",
-    "AverageTimePlayed: ",    "AverageOffenseTime: ",
-    "AverageDefenseTime: "};
+inline constexpr std::string_view averageStringsRender[] = {
+    "AverageWins: ",
+    "AverageLosses: ",
+    "AverageMvps: ",
+    "AverageGames: ",
+    "AverageGoals: ",
+    "AverageDemolitions: ",
+    "AverageDeaths: ",
+    "AverageExterminations: ",
+    "AverageAerialGoals: ",
+    "AverageBackwardsGoals: ",
+    "AverageBicycleGoals: ",
+    "AverageLongGoals: ",
+    "AverageTurtleGoals: ",
+    "AveragePoolShots: ",
+    "AverageOvertimeGoals: ",
+    "AverageHatTricks: ",
+    "AverageAssists: ",
+    "AveragePlaymakers: ",
+    "AverageSaves: ",
+    "AverageEpicSaves: ",
+    "AverageSaviors: ",
+    "AverageShots: ",
+    "AverageCenters: ",
+    "AverageClears: ",
+    "AverageFirstTouchs: ",
+    "AverageDamages: ",
+    "AverageUltraDamages: ",
+    "AverageLowFives: ",
+    "AverageHighFives: ",
+    "AverageSwishs: ",
+    "AverageBicycleHits: ",
+    "AveragePoints: ",
+    "AverageTimePlayed: ",
+    "AverageOffenseTime: ",
+    "AverageDefenseTime: ",
+};
 
-const std::map<std::string, int> eventDictionary = {
-    {"Demolish", demos},
-    {"Demolition", exterms},
-    {"Goal", goals},
-    {"Win", wins},
-    {"MVP", mvps},
+struct EventStat {
+  std::string_view event;
+  int stat;
+};
+
+// StatEvent names to the stat they count, sorted by name for FindEventStat
+inline constexpr EventStat eventDictionary[] = {
     {"AerialGoal", aerialGoals},
+    {"Assist", assists},
     {"BackwardsGoal", backwardsGoals},
     {"BicycleGoal", bicycleGoals},
+    {"BicycleHit", bicycleHits},
+    {"BreakoutDamage", damages},
+    {"BreakoutDamageLarge", ultraDamages},
+    {"Center", centers},
+    {"Clear", clears},
+    {"Demolish", demos},
+    {"Demolition", exterms},
+    {"EpicSave", epicSaves},
+    {"FirstTouch", firstTouchs},
+    {"Goal", goals},
+    {"HatTrick", hatTricks},
+    {"HighFive", highFives},
+    {"HoopsSwishGoal", swishs},
     {"LongGoal", longGoals},
-    {"TurtleGoal", turtleGoals},
-    {"PoolShot", poolShots},
+    {"LowFive", lowFives},
+    {"MVP", mvps},
     {"OvertimeGoal", overtimeGoals},
-    {"HatTrick", hatTricks},
-    {"Assist", assists},
     {"Playmaker", playmakers},
+    {"PoolShot", poolShots},
     {"Save", saves},
-    {"EpicSave", epicSaves},
     {"Savior", saviors},
     {"Shot", shots},
-    {"Center", centers},
-    {"Clear", clears},
-    {"FirstTouch", firstTouchs},
-    {"BreakoutDamage", damages},
-    {"BreakoutDamageLarge", ultraDamages},
-    {"LowFive", lowFives},
-    {"HighFive", highFives},
-    {"HoopsSwishGoal", swishs},
-    {"BicycleHit", bicycleHits}};
\ No newline at end of file
+    {"TurtleGoal", turtleGoals},
+    {"Win", wins},
+};
+
+// Stat counted by a StatEvent name, -1 for events without one
+constexpr int FindEventStat(std::string_view event) {
+  size_t low = 0;
+  size_t high = std::size(eventDictionary);
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (eventDictionary[mid].event < event)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if (low < std::size(eventDictionary) && eventDictionary[low].event == event)
+    return eventDictionary[low].stat;
+  return -1;
+}
+
+namespace maps_detail {
+
+constexpr char Upper(char c) {
+  return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// name with its first letter capitalized, followed by suffix
+constexpr bool IsCapitalized(std::string_view capitalized,
+                             std::string_view name,
+                             std::string_view suffix) {
+  return capitalized.size() == name.size() + suffix.size() &&
+         capitalized[0] == Upper(name[0]) &&
+         capitalized.substr(1, name.size() - 1) == name.substr(1) &&
+         capitalized.substr(name.size()) == suffix;
+}
+
+// Every table entry of a stat agrees with its name in indexStringMap, and each
+// stat with a game counterpart lands on it by adding totalToGame
+constexpr bool TablesMatch() {
+  for (size_t i = 0; i < numStats; ++i) {
+    if (!IsCapitalized(indexStringMapRender[i], indexStringMap[i], ": "))
+      return false;
+  }
+  for (size_t i = 0; i < startGameStats; ++i) {
+    std::string_view name = indexStringMap[i];
+    if (averageStrings[i].substr(0, 7) != "average" ||
+        !IsCapitalized(averageStrings[i].substr(7), name, "") ||
+        !IsCapitalized(averageStringsRender[i], averageStrings[i], ": "))
+      return false;
+    if (i > statsWithoutGame) {
+      std::string_view game = indexStringMap[i + totalToGame];
+      if (game.substr(0, 4) != "game" || !IsCapitalized(game.substr(4), name, ""))
+        return false;
+    }
+  }
+  return true;
+}
+
+constexpr bool EventsSorted() {
+  for (size_t i = 1; i < std::size(eventDictionary); ++i) {
+    if (!(eventDictionary[i - 1].event < eventDictionary[i].event))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace maps_detail
+
+static_assert(std::size(indexStringMap) == numStats, "one name per stat");
+static_assert(std::size(indexStringMapRender) == numStats, "one label per stat");
+static_assert(std::size(averageStrings) == startGameStats,
+              "one average per stat before the game stats");
+static_assert(std::size(averageStringsRender) == startGameStats,
+              "one average label per stat before the game stats");
+static_assert(goals + totalToGame == gameGoals && points + totalToGame == gamePoints &&
+                  timePlayed + totalToGame == gameTime,
+              "totalToGame maps stats to their game stat");
+static_assert(maps_detail::TablesMatch(), "stat tables out of step with the stats enum");
+static_assert(maps_detail::EventsSorted(), "eventDictionary must be sorted by event");
+static_assert(FindEventStat("Goal") == goals && FindEventStat("Win") == wins &&
+                  FindEventStat("Unknown") == -1,
+              "FindEventStat");
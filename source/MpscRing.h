@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded lock-free multi-producer/single-consumer ring.
+// Producers claim a position with a CAS, fill the slot in place and publish
+// it; the single consumer pops in order. Nothing ever blocks: a full ring makes
+// Claim/TryPush fail and the caller decides what to drop.
+template <class T, size_t Capacity>
+class MpscRing {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+
+ public:
+  MpscRing() {
+    for (size_t i = 0; i < Capacity; ++i)
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  MpscRing(MpscRing const&) = delete;
+  MpscRing& operator=(MpscRing const&) = delete;
+
+  // Reserves a slot for the producer. Returns nullptr when the ring is full.
+  T* Claim(size_t& pos) {
+    pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots[pos & (Capacity - 1)];
+      size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed))
+          return &slot.value;
+      } else if (diff < 0) {
+        return nullptr;
+      } else {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Makes a claimed slot visible to the consumer
+  void Publish(size_t pos) {
+    slots[pos & (Capacity - 1)].sequence.store(pos + 1,
+                                               std::memory_order_release);
+  }
+
+  bool TryPush(T const& value) {
+    size_t pos;
+    T* slot = Claim(pos);
+    if (!slot)
+      return false;
+    *slot = value;
+    Publish(pos);
+    return true;
+  }
+
+  // Consumer only
+  bool TryPop(T& out) {
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    Slot& slot = slots[pos & (Capacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+      return false;
+    out = slot.value;
+    slot.sequence.store(pos + Capacity, std::memory_order_release);
+    dequeuePos.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Consumer only. Hands every published slot to consume in order without
+  // copying it out.
+  template <class F>
+  size_t Drain(F&& consume) {
+    size_t count = 0;
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots[pos & (Capacity - 1)];
+      if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+        break;
+      consume(slot.value);
+      slot.sequence.store(pos + Capacity, std::memory_order_release);
+      ++pos;
+      ++count;
+    }
+    dequeuePos.store(pos, std::memory_order_relaxed);
+    return count;
+  }
+
+  // Approximate number of claimed but not yet consumed slots. Safe to read
+  // from any thread.
+  size_t Depth() const {
+    size_t head = enqueuePos.load(std::memory_order_relaxed);
+    size_t tail = dequeuePos.load(std::memory_order_relaxed);
+    return head > tail ? head - tail : 0;
+  }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  alignas(64) std::atomic<size_t> enqueuePos{0};
+  alignas(64) std::atomic<size_t> dequeuePos{0};
+  alignas(64) Slot slots[Capacity];
+};
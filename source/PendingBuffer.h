@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+
+// Fixed capacity FIFO holding commands until GFE is ready for them. Keeps
+// arrival order, so a clip never overtakes the group it belongs to. Single
+// threaded and never allocates.
+template <typename T, size_t Capacity>
+class PendingBuffer {
+ public:
+  // Returns false when full
+  bool Push(T const& value) {
+    if (count == Capacity)
+      return false;
+    items[(head + count) % Capacity] = value;
+    ++count;
+    return true;
+  }
+
+  bool Empty() const { return count == 0; }
+  size_t Depth() const { return count; }
+  T const& Front() const { return items[head]; }
+
+  void Pop() {
+    head = (head + 1) % Capacity;
+    --count;
+  }
+
+  void Clear() {
+    head = 0;
+    count = 0;
+  }
+
+  // Removes every item for which drop(T const&) is true, keeping the order of
+  // the others. Returns the number removed.
+  template <typename F>
+  size_t RemoveIf(F&& drop) {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+      T const& item = items[(head + i) % Capacity];
+      if (drop(item))
+        continue;
+      if (kept != i)
+        items[(head + kept) % Capacity] = item;
+      ++kept;
+    }
+    size_t removed = count - kept;
+    count = kept;
+    return removed;
+  }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+ private:
+  T items[Capacity];
+  size_t head = 0;
+  size_t count = 0;
+};
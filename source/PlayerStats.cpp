@@ -0,0 +1,14 @@
+#include "PlayerStats.h"
+#include <cstring>
+
+void PlayerStatStore::FinishMatch() {
+  for (int row = 0; row < numPlayers; ++row)
+    counts[games][row]++;
+}
+
+void PlayerStatStore::Reset() {
+  std::memset(counts, 0, sizeof(counts));
+  std::memset(pris, 0, sizeof(pris));
+  numPlayers = 0;
+  overflowed = 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "Maps.h"
+
+// Per match counters of every player: one dense column per `stats` entry of
+// Maps.h and one row per player. A PRI gets the next free row the first time
+// it is seen; the game recreates PRIs between matches, so rows only hold until
+// Reset. Recording is O(1) and never allocates, and the store is a plain value
+// so a snapshot is a copy. Game thread only.
+class PlayerStatStore {
+ public:
+  static constexpr int kMaxPlayers = 16;
+  static constexpr int kNoRow = -1;
+
+  PlayerStatStore() { Reset(); }
+
+  // Row of pri, assigned on first sight. kNoRow for a null PRI or when every
+  // row is taken.
+  int Row(uintptr_t pri) {
+    int row = Find(pri);
+    if (row != kNoRow || pri == 0)
+      return row;
+    if (numPlayers == kMaxPlayers) {
+      overflowed++;
+      return kNoRow;
+    }
+    pris[numPlayers] = pri;
+    return numPlayers++;
+  }
+
+  // Adds one to stat for pri, and to its game stat when it has one
+  void Record(uintptr_t pri, int stat) {
+    int row = Row(pri);
+    if (row == kNoRow || stat < 0 || stat >= numStats)
+      return;
+    counts[stat][row]++;
+    if (stat > statsWithoutGame && stat < startGameStats)
+      counts[stat + totalToGame][row]++;
+  }
+
+  // stat of pri so far, 0 for players not seen
+  uint32_t Get(uintptr_t pri, int stat) const {
+    int row = Find(pri);
+    return row == kNoRow ? 0 : counts[stat][row];
+  }
+  uint32_t GetRow(int row, int stat) const { return counts[stat][row]; }
+  // One counter per row, Players() of them in use
+  uint32_t const* Column(int stat) const { return counts[stat]; }
+
+  int Players() const { return numPlayers; }
+  uintptr_t Pri(int row) const { return pris[row]; }
+  // Events of players past kMaxPlayers, not counted
+  uint64_t Overflowed() const { return overflowed; }
+
+  // Counts the match in `games` of every player seen in it
+  void FinishMatch();
+  void Reset();
+
+ private:
+  int Find(uintptr_t pri) const {
+    // At most kMaxPlayers keys, a scan of two cache lines beats hashing
+    for (int row = 0; row < numPlayers; ++row) {
+      if (pris[row] == pri)
+        return row;
+    }
+    return kNoRow;
+  }
+
+  uint32_t counts[numStats][kMaxPlayers];
+  uintptr_t pris[kMaxPlayers];
+  int numPlayers;
+  uint64_t overflowed;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+// Decides when the SDK worker calls NVGSDK_Poll.
+// While requests are outstanding the SDK is polled every busy interval so
+// callbacks (and the contexts they free) are delivered promptly; once nothing
+// is in flight it backs off to the idle interval, which only has to pick up
+// unsolicited notifications.
+class PollScheduler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Intervals may be changed from any thread
+  void SetIntervals(std::chrono::milliseconds busy,
+                    std::chrono::milliseconds idle) {
+    busyMs.store(static_cast<int>(busy.count()), std::memory_order_relaxed);
+    idleMs.store(static_cast<int>(idle.count()), std::memory_order_relaxed);
+  }
+
+  Clock::time_point NextPoll() const { return nextPoll; }
+  bool Due(Clock::time_point now) const { return now >= nextPoll; }
+
+  // A request was just submitted: its callback is now worth polling for soon
+  void OnSubmitted(Clock::time_point now) {
+    Clock::time_point soon = now + Busy();
+    if (soon < nextPoll)
+      nextPoll = soon;
+  }
+
+  void OnPolled(Clock::time_point now, size_t inFlight) {
+    nextPoll = now + (inFlight > 0 ? Busy() : Idle());
+    polls.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  unsigned long long Polls() const {
+    return polls.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::chrono::milliseconds Busy() const {
+    return std::chrono::milliseconds(busyMs.load(std::memory_order_relaxed));
+  }
+  std::chrono::milliseconds Idle() const {
+    return std::chrono::milliseconds(idleMs.load(std::memory_order_relaxed));
+  }
+
+  std::atomic<int> busyMs{5};
+  std::atomic<int> idleMs{250};
+  std::atomic<unsigned long long> polls{0};
+  Clock::time_point nextPoll = Clock::time_point::min();
+};
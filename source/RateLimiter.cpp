@@ -0,0 +1,72 @@
+#include "RateLimiter.h"
+#include <algorithm>
+
+void RateLimiter::Bucket::Configure(RateLimit newLimit) {
+  limit = newLimit;
+  // A bucket holding less than one token would never admit anything
+  if (limit.ratePerSec > 0.0 && limit.burst < 1.0)
+    limit.burst = 1.0;
+  // Start full so the first capture after (re)configuration goes through
+  tokens = limit.burst;
+  lastRefill = Clock::time_point();
+}
+
+bool RateLimiter::Bucket::Ready(Clock::time_point now) {
+  if (limit.ratePerSec <= 0.0)
+    return true;
+  if (lastRefill != Clock::time_point()) {
+    std::chrono::duration<double> elapsed = now - lastRefill;
+    if (elapsed.count() > 0.0)
+      tokens = std::min(limit.burst, tokens + elapsed.count() * limit.ratePerSec);
+  }
+  lastRefill = now;
+  return tokens >= 1.0;
+}
+
+void RateLimiter::Bucket::Take() {
+  if (limit.ratePerSec > 0.0)
+    tokens -= 1.0;
+}
+
+void RateLimiter::Resize(size_t numEvents) {
+  events.resize(numEvents);
+  eventStats.resize(numEvents);
+}
+
+void RateLimiter::SetEventLimit(int slot, RateLimit limit) {
+  events[slot].Configure(limit);
+}
+
+void RateLimiter::SetAllEventLimits(RateLimit limit) {
+  for (Bucket& bucket : events)
+    bucket.Configure(limit);
+}
+
+void RateLimiter::SetGlobalLimit(RateLimit limit) {
+  global.Configure(limit);
+}
+
+bool RateLimiter::TryAdmit(int slot, Clock::time_point now) {
+  Bucket& bucket = events[slot];
+  RateLimiterStats& slotStats = eventStats[slot];
+  if (!bucket.Ready(now)) {
+    stats.throttledEvent++;
+    slotStats.throttledEvent++;
+    return false;
+  }
+  if (!global.Ready(now)) {
+    stats.throttledGlobal++;
+    slotStats.throttledGlobal++;
+    return false;
+  }
+  bucket.Take();
+  global.Take();
+  stats.admitted++;
+  slotStats.admitted++;
+  return true;
+}
+
+void RateLimiter::ResetStats() {
+  stats = {};
+  std::fill(eventStats.begin(), eventStats.end(), RateLimiterStats{});
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Token bucket refilled at ratePerSec up to burst tokens, at least one. A rate
+// of zero or less disables the limit.
+struct RateLimit {
+  double ratePerSec;
+  double burst;
+
+  // One capture per interval, no bursting. The old per event cooldown.
+  static RateLimit Interval(double seconds) {
+    return seconds > 0.0 ? RateLimit{1.0 / seconds, 1.0} : Unlimited();
+  }
+  static RateLimit Unlimited() { return RateLimit{0.0, 0.0}; }
+};
+
+struct RateLimiterStats {
+  uint64_t admitted;
+  // Rejected by the event's own bucket
+  uint64_t throttledEvent;
+  // Rejected by the global bucket capping requests to the GFE backend
+  uint64_t throttledGlobal;
+};
+
+// Admission control for highlight requests, driven by steady_clock so wall
+// clock jumps (NTP, DST) can neither suppress nor release captures.
+// A request is admitted only if both its event bucket and the global bucket
+// hold a token; neither is charged otherwise.
+class RateLimiter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  void Resize(size_t numEvents);
+  void SetEventLimit(int slot, RateLimit limit);
+  void SetAllEventLimits(RateLimit limit);
+  void SetGlobalLimit(RateLimit limit);
+
+  bool TryAdmit(int slot, Clock::time_point now);
+
+  RateLimiterStats Stats() const { return stats; }
+  RateLimiterStats EventStats(int slot) const { return eventStats[slot]; }
+  void ResetStats();
+
+ private:
+  struct Bucket {
+    RateLimit limit = RateLimit::Unlimited();
+    double tokens = 0.0;
+    Clock::time_point lastRefill;
+
+    void Configure(RateLimit newLimit);
+    // Refills and reports whether a token is available, without taking it
+    bool Ready(Clock::time_point now);
+    void Take();
+  };
+
+  std::vector<Bucket> events;
+  std::vector<RateLimiterStats> eventStats;
+  Bucket global;
+  RateLimiterStats stats = {};
+};
@@ -0,0 +1,202 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "ClipCoalescer.h"
+
+enum class RetryKind : uint8_t {
+  OpenGroup,
+  CloseGroup,
+  SaveVideo,
+};
+
+// An SDK call that failed and may be sent again. Clips keep their absolute
+// capture window, so the deltas of a retry still cover the same moment.
+struct RetryItem {
+  RetryKind kind;
+  bool destroyHighlights;
+  // SaveVideo only, groupId of clip is the group for every kind
+  ClipRequest clip;
+  int attempt;
+  // steady_clock ns of the last submission
+  int64_t submittedNs;
+  // Past this the call is not worth making any more
+  int64_t deadlineNs;
+  int64_t dueNs;
+};
+
+struct RetryQueueStats {
+  size_t depth;
+  // Failed calls queued for another attempt
+  uint64_t queued;
+  uint64_t resubmitted;
+  // Retries GFE accepted
+  uint64_t recovered;
+  // Evicted by a more significant call while the queue was full
+  uint64_t dropped;
+  // Out of attempts, past their deadline or superseded
+  uint64_t expired;
+};
+
+// Bounded queue of failed SDK calls with exponential backoff and jitter.
+// GFE rejects highlight calls while it is busy (flushing a recording, overlay
+// open), so failures are tried again until the clip's start leaves GFE's
+// replay buffer. When the queue is full the least significant call goes:
+// group calls rank above every clip, clips rank by their HighlightScorer tier
+// and then by their event priority. Only
+// used by the SDK worker thread; stats may be read from any thread.
+class RetryQueue {
+ public:
+  static constexpr int kMaxAttempts = 6;
+  static constexpr int64_t kBaseBackoffNs = 250000000;
+  static constexpr int64_t kMaxBackoffNs = 8000000000;
+
+  // Schedules another attempt of a call that failed at nowNs. Returns false
+  // when it is out of attempts, past its deadline or least significant in a
+  // full queue.
+  bool Add(RetryItem item, int64_t nowNs) {
+    if (item.attempt >= kMaxAttempts || nowNs >= item.deadlineNs) {
+      AddStat(expired, 1);
+      return false;
+    }
+    item.dueNs = nowNs + Backoff(item.attempt);
+    if (numItems == kCapacity) {
+      size_t weakest = 0;
+      for (size_t i = 1; i < numItems; ++i) {
+        if (LessSignificant(items[i], items[weakest]))
+          weakest = i;
+      }
+      AddStat(dropped, 1);
+      if (!LessSignificant(items[weakest], item))
+        return false;
+      Remove(weakest);
+    }
+    items[numItems++] = item;
+    depth.store(numItems, std::memory_order_relaxed);
+    AddStat(queued, 1);
+    return true;
+  }
+
+  int64_t NextDueNs() const {
+    int64_t next = INT64_MAX;
+    for (size_t i = 0; i < numItems; ++i) {
+      if (items[i].dueNs < next)
+        next = items[i].dueNs;
+    }
+    return next;
+  }
+
+  size_t Depth() const { return numItems; }
+
+  // Hands every call due by nowNs to resubmit(RetryItem const&), with attempt
+  // and submittedNs updated. Calls past their deadline go to
+  // expire(RetryItem const&) instead.
+  template <typename F, typename G>
+  size_t PopDue(int64_t nowNs, F&& resubmit, G&& expire) {
+    size_t popped = 0;
+    for (size_t i = 0; i < numItems;) {
+      if (items[i].dueNs > nowNs) {
+        ++i;
+        continue;
+      }
+      RetryItem item = items[i];
+      Remove(i);
+      if (nowNs >= item.deadlineNs) {
+        AddStat(expired, 1);
+        expire(item);
+        continue;
+      }
+      item.attempt++;
+      item.submittedNs = nowNs;
+      AddStat(resubmitted, 1);
+      resubmit(item);
+      ++popped;
+    }
+    return popped;
+  }
+
+  // Drops queued group calls, superseded by a newer group call
+  void DropGroupCalls() {
+    for (size_t i = 0; i < numItems;) {
+      if (items[i].kind == RetryKind::SaveVideo) {
+        ++i;
+        continue;
+      }
+      Remove(i);
+      AddStat(expired, 1);
+    }
+  }
+
+  void RecordRecovered() { AddStat(recovered, 1); }
+  // A queued or returned call was dropped by the caller, e.g. superseded
+  void RecordExpired() { AddStat(expired, 1); }
+
+  // Drops everything queued, counted as expired
+  void Clear() {
+    AddStat(expired, numItems);
+    numItems = 0;
+    depth.store(0, std::memory_order_relaxed);
+  }
+
+  RetryQueueStats Stats() const {
+    RetryQueueStats stats;
+    stats.depth = depth.load(std::memory_order_relaxed);
+    stats.queued = queued.load(std::memory_order_relaxed);
+    stats.resubmitted = resubmitted.load(std::memory_order_relaxed);
+    stats.recovered = recovered.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.expired = expired.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  static constexpr size_t kCapacity = 32;
+
+  static bool LessSignificant(RetryItem const& a, RetryItem const& b) {
+    // Clips saved into a group that failed to open are lost as well
+    bool aClip = a.kind == RetryKind::SaveVideo;
+    bool bClip = b.kind == RetryKind::SaveVideo;
+    if (aClip != bClip)
+      return aClip;
+    if (!aClip)
+      return false;
+    if (a.clip.tier != b.clip.tier)
+      return a.clip.tier < b.clip.tier;
+    return a.clip.priority < b.clip.priority;
+  }
+
+  // Doubles per attempt up to kMaxBackoffNs, then picks uniformly from the
+  // upper half so calls failing together do not come back together
+  int64_t Backoff(int attempt) {
+    int64_t backoff = kBaseBackoffNs << (attempt < 8 ? attempt : 8);
+    if (backoff > kMaxBackoffNs)
+      backoff = kMaxBackoffNs;
+    // xorshift32
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return backoff / 2 + static_cast<int64_t>(rng % static_cast<uint64_t>(backoff / 2 + 1));
+  }
+
+  // Single writer, so plain load + store keeps the counters cheap
+  static void AddStat(std::atomic<uint64_t>& stat, uint64_t value) {
+    stat.store(stat.load(std::memory_order_relaxed) + value,
+               std::memory_order_relaxed);
+  }
+
+  void Remove(size_t i) {
+    items[i] = items[--numItems];
+    depth.store(numItems, std::memory_order_relaxed);
+  }
+
+  RetryItem items[kCapacity];
+  size_t numItems = 0;
+  uint32_t rng = 0x9E3779B9;
+  std::atomic<size_t> depth{0};
+  std::atomic<uint64_t> queued{0};
+  std::atomic<uint64_t> resubmitted{0};
+  std::atomic<uint64_t> recovered{0};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint64_t> expired{0};
+};
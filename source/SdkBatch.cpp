@@ -0,0 +1,144 @@
+#include "SdkBatch.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+
+namespace {
+
+struct BatchItem {
+  SdkBatch* batch;
+  int rc;
+  bool done;
+};
+
+}  // namespace
+
+struct SdkBatch {
+  size_t count;
+  std::atomic<size_t> completed{0};
+  std::atomic<size_t> failed{0};
+  std::atomic<int> references{2};
+  // Position in the submitter's pending list, SDK thread only
+  SdkBatch** prevNext = nullptr;
+  SdkBatch* next = nullptr;
+  // Only taken by waiters and by the last completion
+  std::mutex mutex;
+  std::condition_variable finished;
+  // count items follow the header in the same allocation
+  BatchItem* Items() { return reinterpret_cast<BatchItem*>(this + 1); }
+  BatchItem const* Items() const {
+    return reinterpret_cast<BatchItem const*>(this + 1);
+  }
+};
+
+static_assert(sizeof(SdkBatch) % alignof(BatchItem) == 0,
+              "batch items must follow the header aligned");
+
+namespace {
+
+void Unlink(SdkBatch* batch) {
+  if (!batch->prevNext)
+    return;
+  *batch->prevNext = batch->next;
+  if (batch->next)
+    batch->next->prevNext = batch->prevNext;
+  batch->prevNext = nullptr;
+  batch->next = nullptr;
+}
+
+void Complete(BatchItem* item, int rc) {
+  SdkBatch* batch = item->batch;
+  item->rc = rc;
+  item->done = true;
+  if (rc < 0)
+    batch->failed.fetch_add(1, std::memory_order_relaxed);
+  // Release: the results are visible to whoever sees the final count
+  if (batch->completed.fetch_add(1, std::memory_order_release) + 1 != batch->count)
+    return;
+  Unlink(batch);
+  {
+    std::lock_guard<std::mutex> lock(batch->mutex);
+    batch->finished.notify_all();
+  }
+  SdkBatchRelease(batch);
+}
+
+}  // namespace
+
+SdkBatch* SdkBatchCreate(SdkBatch** pending, size_t count) {
+  void* memory = ::operator new(sizeof(SdkBatch) + count * sizeof(BatchItem));
+  SdkBatch* batch = new (memory) SdkBatch;
+  batch->count = count;
+  for (size_t i = 0; i < count; ++i)
+    batch->Items()[i] = {batch, 0, false};
+  if (count == 0) {
+    // Nothing will complete it
+    batch->references.store(1, std::memory_order_relaxed);
+    return batch;
+  }
+  batch->next = *pending;
+  if (batch->next)
+    batch->next->prevNext = &batch->next;
+  batch->prevNext = pending;
+  *pending = batch;
+  return batch;
+}
+
+void* SdkBatchItem(SdkBatch* batch, size_t index) {
+  return &batch->Items()[index];
+}
+
+void SdkBatchItemDone(void* item, int rc) {
+  Complete(static_cast<BatchItem*>(item), rc);
+}
+
+void SdkBatchCancelPending(SdkBatch** pending, int rc) {
+  while (SdkBatch* batch = *pending) {
+    // The last Complete unlinks the batch and may free it, so stop by count
+    size_t remaining = batch->count - batch->completed.load(std::memory_order_relaxed);
+    for (size_t i = 0; remaining > 0; ++i) {
+      BatchItem* item = &batch->Items()[i];
+      if (!item->done) {
+        --remaining;
+        Complete(item, rc);
+      }
+    }
+  }
+}
+
+void SdkBatchRelease(SdkBatch* batch) {
+  if (!batch || batch->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    return;
+  batch->~SdkBatch();
+  ::operator delete(batch);
+}
+
+size_t SdkBatchSize(SdkBatch const* batch) {
+  return batch->count;
+}
+
+size_t SdkBatchCompleted(SdkBatch const* batch) {
+  return batch->completed.load(std::memory_order_acquire);
+}
+
+bool SdkBatchDone(SdkBatch const* batch) {
+  return SdkBatchCompleted(batch) == batch->count;
+}
+
+bool SdkBatchWait(SdkBatch* batch, uint32_t timeoutMs) {
+  if (SdkBatchDone(batch))
+    return true;
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  return batch->finished.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                                  [batch]() { return SdkBatchDone(batch); });
+}
+
+int SdkBatchResult(SdkBatch const* batch, size_t index) {
+  return batch->Items()[index].rc;
+}
+
+size_t SdkBatchFailed(SdkBatch const* batch) {
+  return batch->failed.load(std::memory_order_relaxed);
+}
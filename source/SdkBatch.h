@@ -0,0 +1,42 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Shared completion of a set of async SDK calls submitted together. Each call
+// gets SdkBatchItem(batch, i) as its context and reports its result with
+// SdkBatchItemDone; the submitter polls or waits on the one batch instead of
+// handling every callback.
+//
+// A batch holds two references: the caller's, dropped by SdkBatchRelease, and
+// the submitter's, dropped when the last item completes. Unfinished batches
+// are linked into the submitting session's list so SdkBatchCancelPending can
+// finish them when the SDK handle goes away. Create, ItemDone and
+// CancelPending run on the SDK thread; the other functions on any thread.
+typedef struct SdkBatch SdkBatch;
+
+SdkBatch* SdkBatchCreate(SdkBatch** pending, size_t count);
+void* SdkBatchItem(SdkBatch* batch, size_t index);
+void SdkBatchItemDone(void* item, int rc);
+// Completes the remaining items of every batch in the list with rc
+void SdkBatchCancelPending(SdkBatch** pending, int rc);
+void SdkBatchRelease(SdkBatch* batch);
+
+size_t SdkBatchSize(SdkBatch const* batch);
+size_t SdkBatchCompleted(SdkBatch const* batch);
+bool SdkBatchDone(SdkBatch const* batch);
+// Blocks until every item completed or timeoutMs passed, returns
+// SdkBatchDone. Must not be called from the thread that polls the SDK.
+bool SdkBatchWait(SdkBatch* batch, uint32_t timeoutMs);
+// Result of one item, valid once SdkBatchDone
+int SdkBatchResult(SdkBatch const* batch, size_t index);
+// Items that completed with a failure code
+size_t SdkBatchFailed(SdkBatch const* batch);
+
+#ifdef __cplusplus
+}
+#endif
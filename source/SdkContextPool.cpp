@@ -0,0 +1,117 @@
+#include "SdkContextPool.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t kNumSlots = 64;
+constexpr uint32_t kNoSlot = 0xFFFFFFFF;
+
+struct alignas(alignof(std::max_align_t)) Slot {
+  unsigned char bytes[SDK_CONTEXT_SLOT_SIZE];
+};
+
+uint64_t MakeHead(uint64_t previous, uint32_t slot) {
+  return (((previous >> 32) + 1) << 32) | slot;
+}
+
+}  // namespace
+
+// Cache line aligned so pools of sessions on different threads never share a
+// line
+struct alignas(64) SdkContextPool {
+  Slot slots[kNumSlots];
+  // Free list as a lock-free stack of slot indices. The head packs the top
+  // index in the low half and a counter bumped on every change in the high
+  // half, so a pop racing with a pop and push of the same slot fails its
+  // exchange (ABA).
+  std::atomic<uint32_t> next[kNumSlots];
+  std::atomic<uint64_t> head{kNoSlot};
+
+  std::atomic<size_t> inUse{0};
+  std::atomic<size_t> highWater{0};
+  std::atomic<uint64_t> exhausted{0};
+  std::atomic<uint64_t> oversized{0};
+
+  uint32_t PopSlot() {
+    uint64_t top = head.load(std::memory_order_acquire);
+    for (;;) {
+      uint32_t slot = static_cast<uint32_t>(top);
+      if (slot == kNoSlot)
+        return kNoSlot;
+      uint32_t below = next[slot].load(std::memory_order_relaxed);
+      if (head.compare_exchange_weak(top, MakeHead(top, below),
+                                     std::memory_order_acquire,
+                                     std::memory_order_acquire))
+        return slot;
+    }
+  }
+
+  void PushSlot(uint32_t slot) {
+    uint64_t top = head.load(std::memory_order_relaxed);
+    do {
+      next[slot].store(static_cast<uint32_t>(top), std::memory_order_relaxed);
+    } while (!head.compare_exchange_weak(top, MakeHead(top, slot),
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+  }
+
+  bool IsSlot(void const* context) const {
+    return context >= static_cast<void const*>(&slots[0]) &&
+           context < static_cast<void const*>(&slots[kNumSlots]);
+  }
+};
+
+SdkContextPool* SdkContextPoolCreate(void) {
+  SdkContextPool* pool = new SdkContextPool;
+  for (uint32_t i = 0; i < kNumSlots; ++i)
+    pool->next[i].store(i + 1 < kNumSlots ? i + 1 : kNoSlot, std::memory_order_relaxed);
+  pool->head.store(MakeHead(0, 0), std::memory_order_release);
+  return pool;
+}
+
+void SdkContextPoolDestroy(SdkContextPool* pool) {
+  delete pool;
+}
+
+void* SdkContextAlloc(SdkContextPool* pool, size_t size) {
+  if (size > SDK_CONTEXT_SLOT_SIZE) {
+    pool->oversized.fetch_add(1, std::memory_order_relaxed);
+    return std::calloc(1, size);
+  }
+  uint32_t slot = pool->PopSlot();
+  if (slot == kNoSlot) {
+    pool->exhausted.fetch_add(1, std::memory_order_relaxed);
+    return std::calloc(1, size);
+  }
+
+  size_t inUse = pool->inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+  size_t highWater = pool->highWater.load(std::memory_order_relaxed);
+  while (inUse > highWater &&
+         !pool->highWater.compare_exchange_weak(highWater, inUse,
+                                                std::memory_order_relaxed)) {
+  }
+  std::memset(pool->slots[slot].bytes, 0, size);
+  return pool->slots[slot].bytes;
+}
+
+void SdkContextFree(SdkContextPool* pool, void* context) {
+  if (!pool->IsSlot(context)) {
+    std::free(context);
+    return;
+  }
+  pool->inUse.fetch_sub(1, std::memory_order_relaxed);
+  pool->PushSlot(static_cast<uint32_t>(static_cast<Slot*>(context) - &pool->slots[0]));
+}
+
+SdkContextPoolStats GetSdkContextPoolStats(SdkContextPool const* pool) {
+  SdkContextPoolStats stats;
+  stats.capacity = kNumSlots;
+  stats.inUse = pool->inUse.load(std::memory_order_relaxed);
+  stats.highWater = pool->highWater.load(std::memory_order_relaxed);
+  stats.exhausted = pool->exhausted.load(std::memory_order_relaxed);
+  stats.oversized = pool->oversized.load(std::memory_order_relaxed);
+  return stats;
+}
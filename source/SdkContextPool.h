@@ -0,0 +1,40 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fixed size slots for the parameters and contexts of async SDK calls, which
+// must live until the call's callback runs. Each session preallocates its own
+// pool, so SDK traffic does no malloc/free. Requests larger than a slot, or
+// made while every slot is in use, fall back to the heap and are counted.
+// Alloc and Free may be called from any thread.
+#define SDK_CONTEXT_SLOT_SIZE 256
+
+typedef struct SdkContextPool SdkContextPool;
+
+SdkContextPool* SdkContextPoolCreate(void);
+void SdkContextPoolDestroy(SdkContextPool* pool);
+// Returns zeroed memory of at least `size` bytes
+void* SdkContextAlloc(SdkContextPool* pool, size_t size);
+// Accepts pool slots and heap fallbacks alike, NULL is ignored
+void SdkContextFree(SdkContextPool* pool, void* context);
+
+#ifdef __cplusplus
+}
+
+struct SdkContextPoolStats {
+  size_t capacity;
+  size_t inUse;
+  // Most slots in use at once
+  size_t highWater;
+  // Allocations that went to the heap because every slot was in use
+  uint64_t exhausted;
+  // Allocations that went to the heap because they did not fit in a slot
+  uint64_t oversized;
+};
+
+SdkContextPoolStats GetSdkContextPoolStats(SdkContextPool const* pool);
+#endif
@@ -0,0 +1,267 @@
+#include "SdkRequests.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include "LatencyHistogram.h"
+
+namespace {
+
+constexpr size_t kMaxRequests = 256;
+// NVGSDK_RetCode failures run from -1001 down, with room for newer GFE codes
+constexpr int kFirstFailureCode = -1001;
+constexpr size_t kFailureCodes = 48;
+
+// The id, type and start are atomics so GetSdkRequestsInFlight can read a slot
+// while the SDK thread reuses it. id is 0 while the slot is free and is
+// written last by Begin, so a reader seeing the same id before and after
+// reading the other fields got a consistent request.
+struct SdkRequest {
+  SdkRequestTable* table;
+  std::atomic<uint64_t> id{0};
+  std::atomic<SdkCallType> type{SDK_CALL_COUNT};
+  std::atomic<int64_t> startNs{0};
+  void* userContext;
+};
+
+struct CallMetrics {
+  std::atomic<uint64_t> submitted{0};
+  std::atomic<uint64_t> succeeded{0};
+  std::atomic<uint64_t> failed{0};
+  std::atomic<uint64_t> inFlight{0};
+  std::atomic<uint64_t> overflowed{0};
+  // [0] counts codes out of range, [i] counts kFirstFailureCode - (i - 1)
+  std::atomic<uint64_t> failures[kFailureCodes + 1] = {};
+  LatencyHistogram latency;
+};
+
+size_t FailureIndex(int rc) {
+  int offset = kFirstFailureCode - rc;
+  return offset >= 0 && offset < static_cast<int>(kFailureCodes) ? offset + 1 : 0;
+}
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+// Cache line aligned so tables of sessions on different threads never share
+// a line
+struct alignas(64) SdkRequestTable {
+  void* owner;
+  // Owned by the SDK thread, see SdkRequestBegin
+  SdkRequest requests[kMaxRequests];
+  uint16_t freeSlots[kMaxRequests];
+  size_t numFree;
+
+  // Owned by the SDK thread, ids start at 1
+  uint64_t lastId;
+
+  std::atomic<size_t> inFlight{0};
+  CallMetrics metrics[SDK_CALL_COUNT];
+
+  bool IsSlot(SdkRequest const* request) const {
+    return request >= &requests[0] && request < &requests[kMaxRequests];
+  }
+};
+
+SdkRequestTable* SdkRequestTableCreate(void* owner) {
+  SdkRequestTable* table = new SdkRequestTable;
+  table->owner = owner;
+  table->lastId = 0;
+  for (size_t i = 0; i < kMaxRequests; ++i)
+    table->freeSlots[i] = static_cast<uint16_t>(kMaxRequests - 1 - i);
+  table->numFree = kMaxRequests;
+  return table;
+}
+
+void SdkRequestTableDestroy(SdkRequestTable* table) {
+  delete table;
+}
+
+void* SdkRequestBegin(SdkRequestTable* table, SdkCallType type, void* userContext) {
+  CallMetrics& metrics = table->metrics[type];
+  metrics.submitted.fetch_add(1, std::memory_order_relaxed);
+  SdkRequest* request;
+  if (table->numFree > 0) {
+    request = &table->requests[table->freeSlots[--table->numFree]];
+  }
+  else {
+    metrics.overflowed.fetch_add(1, std::memory_order_relaxed);
+    request = new SdkRequest;
+  }
+  request->table = table;
+  request->userContext = userContext;
+  // Orders the clearing of the slot's last id before the new fields
+  std::atomic_thread_fence(std::memory_order_release);
+  request->type.store(type, std::memory_order_relaxed);
+  request->startNs.store(NowNs(), std::memory_order_relaxed);
+  request->id.store(++table->lastId, std::memory_order_release);
+  metrics.inFlight.fetch_add(1, std::memory_order_relaxed);
+  table->inFlight.fetch_add(1, std::memory_order_relaxed);
+  return request;
+}
+
+void* SdkRequestOwner(void const* context) {
+  return static_cast<SdkRequest const*>(context)->table->owner;
+}
+
+uint64_t SdkRequestId(void const* context) {
+  return static_cast<SdkRequest const*>(context)->id.load(std::memory_order_relaxed);
+}
+
+void* SdkRequestEnd(void* context, int rc) {
+  SdkRequest* request = static_cast<SdkRequest*>(context);
+  SdkRequestTable* table = request->table;
+  CallMetrics& metrics = table->metrics[request->type.load(std::memory_order_relaxed)];
+  metrics.latency.Record(static_cast<uint64_t>(
+      NowNs() - request->startNs.load(std::memory_order_relaxed)));
+  if (rc >= 0) {
+    metrics.succeeded.fetch_add(1, std::memory_order_relaxed);
+  }
+  else {
+    metrics.failed.fetch_add(1, std::memory_order_relaxed);
+    metrics.failures[FailureIndex(rc)].fetch_add(1, std::memory_order_relaxed);
+  }
+  request->id.store(0, std::memory_order_relaxed);
+  metrics.inFlight.fetch_sub(1, std::memory_order_relaxed);
+  table->inFlight.fetch_sub(1, std::memory_order_relaxed);
+
+  void* userContext = request->userContext;
+  if (table->IsSlot(request))
+    table->freeSlots[table->numFree++] = static_cast<uint16_t>(request - &table->requests[0]);
+  else
+    delete request;
+  return userContext;
+}
+
+size_t SdkRequestsInFlight(SdkRequestTable const* table) {
+  return table->inFlight.load(std::memory_order_relaxed);
+}
+
+char const* SdkCallTypeName(SdkCallType type) {
+  switch (type) {
+    case SDK_CALL_REQUEST_PERMISSIONS:
+      return "RequestPermissions";
+    case SDK_CALL_CONFIGURE:
+      return "Configure";
+    case SDK_CALL_OPEN_GROUP:
+      return "OpenGroup";
+    case SDK_CALL_CLOSE_GROUP:
+      return "CloseGroup";
+    case SDK_CALL_SAVE_SCREENSHOT:
+      return "SetScreenshotHighlight";
+    case SDK_CALL_SAVE_VIDEO:
+      return "SetVideoHighlight";
+    case SDK_CALL_OPEN_SUMMARY:
+      return "OpenSummary";
+    case SDK_CALL_GET_NUM_HIGHLIGHTS:
+      return "GetNumberOfHighlights";
+    case SDK_CALL_GET_LANGUAGE:
+      return "GetUILanguage";
+    case SDK_CALL_GET_USER_SETTINGS:
+      return "GetUserSettings";
+    default:
+      return "Unknown";
+  }
+}
+
+SdkCallStats GetSdkCallStats(SdkRequestTable const* table, SdkCallType type) {
+  CallMetrics const& metrics = table->metrics[type];
+  SdkCallStats stats;
+  stats.submitted = metrics.submitted.load(std::memory_order_relaxed);
+  stats.succeeded = metrics.succeeded.load(std::memory_order_relaxed);
+  stats.failed = metrics.failed.load(std::memory_order_relaxed);
+  stats.inFlight = metrics.inFlight.load(std::memory_order_relaxed);
+  stats.overflowed = metrics.overflowed.load(std::memory_order_relaxed);
+  stats.meanUs = metrics.latency.MeanUs();
+  stats.p50Us = metrics.latency.PercentileUs(50);
+  stats.p90Us = metrics.latency.PercentileUs(90);
+  stats.p99Us = metrics.latency.PercentileUs(99);
+  stats.p999Us = metrics.latency.PercentileUs(99.9);
+  stats.maxUs = metrics.latency.MaxUs();
+  return stats;
+}
+
+std::vector<SdkCallFailure> GetSdkCallFailures(SdkRequestTable const* table,
+                                               SdkCallType type) {
+  CallMetrics const& metrics = table->metrics[type];
+  std::vector<SdkCallFailure> failures;
+  for (size_t i = 0; i <= kFailureCodes; ++i) {
+    uint64_t count = metrics.failures[i].load(std::memory_order_relaxed);
+    if (count > 0)
+      failures.push_back({i == 0 ? 0 : kFirstFailureCode - static_cast<int>(i - 1), count});
+  }
+  std::sort(failures.begin(), failures.end(),
+            [](SdkCallFailure const& a, SdkCallFailure const& b) {
+              return a.count > b.count;
+            });
+  return failures;
+}
+
+std::vector<SdkInFlightRequest> GetSdkRequestsInFlight(SdkRequestTable const* table,
+                                                       size_t max) {
+  std::vector<SdkInFlightRequest> requests;
+  int64_t now = NowNs();
+  for (SdkRequest const& request : table->requests) {
+    uint64_t id = request.id.load(std::memory_order_acquire);
+    if (id == 0)
+      continue;
+    SdkCallType type = request.type.load(std::memory_order_relaxed);
+    int64_t startNs = request.startNs.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (request.id.load(std::memory_order_relaxed) != id)
+      continue;
+    requests.push_back({id, type, (now - startNs) / 1000.0});
+  }
+  std::sort(requests.begin(), requests.end(),
+            [](SdkInFlightRequest const& a, SdkInFlightRequest const& b) {
+              return a.id < b.id;
+            });
+  if (requests.size() > max)
+    requests.resize(max);
+  return requests;
+}
+
+std::vector<std::string> SdkRequestReport(SdkRequestTable const* table,
+                                          char const* (*retCodeName)(int rc)) {
+  std::vector<std::string> lines;
+  char line[256];
+  for (int type = 0; type < SDK_CALL_COUNT; type++) {
+    SdkCallType callType = static_cast<SdkCallType>(type);
+    SdkCallStats call = GetSdkCallStats(table, callType);
+    if (call.submitted == 0)
+      continue;
+    std::snprintf(line, sizeof(line),
+                  "%s: submitted %llu, ok %llu, failed %llu, in flight %llu, overflowed %llu",
+                  SdkCallTypeName(callType), (unsigned long long)call.submitted,
+                  (unsigned long long)call.succeeded, (unsigned long long)call.failed,
+                  (unsigned long long)call.inFlight, (unsigned long long)call.overflowed);
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line),
+                  "  latency us: mean %.0f, p50 %.0f, p90 %.0f, p99 %.0f, p99.9 %.0f, max %.0f",
+                  call.meanUs, call.p50Us, call.p90Us, call.p99Us, call.p999Us, call.maxUs);
+    lines.push_back(line);
+    for (SdkCallFailure const& failure : GetSdkCallFailures(table, callType)) {
+      std::snprintf(line, sizeof(line), "  failed with %s: %llu",
+                    failure.rc == 0 ? "other codes" : retCodeName(failure.rc),
+                    (unsigned long long)failure.count);
+      lines.push_back(line);
+    }
+  }
+  constexpr size_t kListed = 8;
+  std::vector<SdkInFlightRequest> waiting = GetSdkRequestsInFlight(table, kListed);
+  std::snprintf(line, sizeof(line), "in flight: %zu requests%s",
+                SdkRequestsInFlight(table), waiting.empty() ? "" : ", oldest first:");
+  lines.push_back(line);
+  for (SdkInFlightRequest const& request : waiting) {
+    std::snprintf(line, sizeof(line), "  #%llu %s, waiting %.1fms",
+                  (unsigned long long)request.id, SdkCallTypeName(request.type),
+                  request.ageUs / 1000.0);
+    lines.push_back(line);
+  }
+  return lines;
+}
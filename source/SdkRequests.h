@@ -0,0 +1,96 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  SDK_CALL_REQUEST_PERMISSIONS,
+  SDK_CALL_CONFIGURE,
+  SDK_CALL_OPEN_GROUP,
+  SDK_CALL_CLOSE_GROUP,
+  SDK_CALL_SAVE_SCREENSHOT,
+  SDK_CALL_SAVE_VIDEO,
+  SDK_CALL_OPEN_SUMMARY,
+  SDK_CALL_GET_NUM_HIGHLIGHTS,
+  SDK_CALL_GET_LANGUAGE,
+  SDK_CALL_GET_USER_SETTINGS,
+  SDK_CALL_COUNT
+} SdkCallType;
+
+typedef struct SdkRequestTable SdkRequestTable;
+
+// Tracks the async SDK calls of one session from submission to callback.
+// SdkRequestBegin returns the pointer passed to the SDK as the callback
+// context; the callback hands it to SdkRequestOwner to find its session and to
+// SdkRequestEnd to get the caller's own context back. Every request gets an
+// id, increasing per table, and its submission time. Requests are slots in a
+// fixed table, with a heap fallback when it is full. Begin and End must be
+// called from the thread that owns the SDK handle, which is also the thread
+// polling for callbacks.
+SdkRequestTable* SdkRequestTableCreate(void* owner);
+void SdkRequestTableDestroy(SdkRequestTable* table);
+void* SdkRequestBegin(SdkRequestTable* table, SdkCallType type, void* userContext);
+void* SdkRequestOwner(void const* request);
+uint64_t SdkRequestId(void const* request);
+void* SdkRequestEnd(void* request, int rc);
+// Safe to call from any thread
+size_t SdkRequestsInFlight(SdkRequestTable const* table);
+
+char const* SdkCallTypeName(SdkCallType type);
+
+#ifdef __cplusplus
+}
+
+#include <string>
+#include <vector>
+
+struct SdkCallStats {
+  uint64_t submitted;
+  uint64_t succeeded;
+  uint64_t failed;
+  uint64_t inFlight;
+  // Submitted while every slot of the table was in use
+  uint64_t overflowed;
+  // Request to callback latency
+  double meanUs;
+  double p50Us;
+  double p90Us;
+  double p99Us;
+  double p999Us;
+  double maxUs;
+};
+
+SdkCallStats GetSdkCallStats(SdkRequestTable const* table, SdkCallType type);
+
+// Failures of one call type by return code. NVGSDK_RetCode failures are
+// counted one by one from -1001 down; codes outside that range share the
+// entry with rc 0.
+struct SdkCallFailure {
+  int rc;
+  uint64_t count;
+};
+
+std::vector<SdkCallFailure> GetSdkCallFailures(SdkRequestTable const* table,
+                                               SdkCallType type);
+
+struct SdkInFlightRequest {
+  uint64_t id;
+  SdkCallType type;
+  double ageUs;
+};
+
+// Requests waiting for their callback, oldest first, at most `max` of them.
+// Heap fallbacks are not listed, see SdkCallStats::overflowed. Safe to call
+// from any thread; a request completing meanwhile may be left out.
+std::vector<SdkInFlightRequest> GetSdkRequestsInFlight(SdkRequestTable const* table,
+                                                       size_t max);
+
+// Console report of the table: counters, latency percentiles and failures per
+// call type that was used, then the oldest requests still in flight.
+// retCodeName turns a return code into text, e.g. NVGSDK_RetCodeToString.
+std::vector<std::string> SdkRequestReport(SdkRequestTable const* table,
+                                          char const* (*retCodeName)(int rc));
+#endif
@@ -0,0 +1,205 @@
+#include "SdkStatus.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <gfesdk/sdk_types.h>
+
+namespace {
+
+char const* PermissionName(int permission) {
+  switch (permission) {
+    case NVGSDK_PERMISSION_MUST_ASK:
+      return "Must Ask";
+    case NVGSDK_PERMISSION_GRANTED:
+      return "Granted";
+    case NVGSDK_PERMISSION_DENIED:
+      return "Denied";
+    default:
+      return "Unknown";
+  }
+}
+
+char const* OverlayName(int state) {
+  switch (state) {
+    case NVGSDK_OVERLAY_STATE_MAIN:
+      return "Main Overlay Window";
+    case NVGSDK_OVERLAY_STATE_PERMISSION:
+      return "Permission Overlay Window";
+    case NVGSDK_OVERLAY_STATE_HIGHLIGHTS_SUMMARY:
+      return "Highlights Summary Overlay Window";
+    default:
+      return "Unknown Window";
+  }
+}
+
+}  // namespace
+
+char const* SdkReadinessName(int readiness) {
+  switch (readiness) {
+    case SDK_READINESS_NO_HANDLE:
+      return "No Handle";
+    case SDK_READINESS_AWAITING_PERMISSION:
+      return "Awaiting Permission";
+    case SDK_READINESS_CONFIGURING:
+      return "Configuring";
+    case SDK_READINESS_OPENING_GROUP:
+      return "Opening Group";
+    case SDK_READINESS_READY:
+      return "Ready";
+    case SDK_READINESS_FAILED:
+      return "Failed";
+    default:
+      return "Unknown";
+  }
+}
+
+// Cache line aligned so sessions on different threads never share a line.
+// Fields are atomics accessed relaxed, ordered by the sequence counter: odd
+// while the single writer is updating them, so a reader that sees the same
+// even value before and after its copy has a consistent snapshot.
+struct alignas(64) SdkStatusCell {
+  std::atomic<uint64_t> sequence{0};
+  std::atomic<int> lastResult{0};
+  std::atomic<int> readiness{SDK_READINESS_NO_HANDLE};
+  std::atomic<int> permission{NVGSDK_PERMISSION_MUST_ASK};
+  std::atomic<int> overlayState{NVGSDK_OVERLAY_STATE_MAX};
+  std::atomic<bool> overlayOpen{false};
+  std::atomic<int> numHighlights{-1};
+  std::atomic<uint64_t> userSettings{0};
+  std::atomic<int> numUserSettings{-1};
+  std::atomic<uint64_t> language[2] = {};
+
+  template <typename Write>
+  void Publish(Write&& write) {
+    uint64_t before = sequence.load(std::memory_order_relaxed);
+    sequence.store(before + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    write();
+    sequence.store(before + 2, std::memory_order_release);
+  }
+
+  // Only the writer calls this, so the relaxed load sees its own latest value
+  template <typename T>
+  void PublishIfChanged(std::atomic<T>& field, T value) {
+    if (field.load(std::memory_order_relaxed) == value)
+      return;
+    Publish([&] { field.store(value, std::memory_order_relaxed); });
+  }
+};
+
+SdkStatusCell* SdkStatusCreate(void) {
+  return new SdkStatusCell;
+}
+
+void SdkStatusDestroy(SdkStatusCell* cell) {
+  delete cell;
+}
+
+void SdkStatusSetResult(SdkStatusCell* cell, int rc) {
+  cell->PublishIfChanged(cell->lastResult, rc);
+}
+
+void SdkStatusSetPermission(SdkStatusCell* cell, int permission) {
+  cell->PublishIfChanged(cell->permission, permission);
+}
+
+void SdkStatusSetReadiness(SdkStatusCell* cell, int readiness) {
+  cell->PublishIfChanged(cell->readiness, readiness);
+}
+
+void SdkStatusSetOverlay(SdkStatusCell* cell, int state, bool open) {
+  if (cell->overlayState.load(std::memory_order_relaxed) == state &&
+      cell->overlayOpen.load(std::memory_order_relaxed) == open)
+    return;
+  cell->Publish([&] {
+    cell->overlayState.store(state, std::memory_order_relaxed);
+    cell->overlayOpen.store(open, std::memory_order_relaxed);
+  });
+}
+
+void SdkStatusSetNumHighlights(SdkStatusCell* cell, int numHighlights) {
+  cell->PublishIfChanged(cell->numHighlights, numHighlights);
+}
+
+void SdkStatusSetUserSettings(SdkStatusCell* cell, uint64_t enabled, int numSettings) {
+  if (cell->userSettings.load(std::memory_order_relaxed) == enabled &&
+      cell->numUserSettings.load(std::memory_order_relaxed) == numSettings)
+    return;
+  cell->Publish([&] {
+    cell->userSettings.store(enabled, std::memory_order_relaxed);
+    cell->numUserSettings.store(numSettings, std::memory_order_relaxed);
+  });
+}
+
+void SdkStatusSetLanguage(SdkStatusCell* cell, char const* cultureCode) {
+  uint64_t words[2] = {};
+  if (cultureCode)
+    std::strncpy(reinterpret_cast<char*>(words), cultureCode, sizeof(words) - 1);
+  if (cell->language[0].load(std::memory_order_relaxed) == words[0] &&
+      cell->language[1].load(std::memory_order_relaxed) == words[1])
+    return;
+  cell->Publish([&] {
+    cell->language[0].store(words[0], std::memory_order_relaxed);
+    cell->language[1].store(words[1], std::memory_order_relaxed);
+  });
+}
+
+uint64_t SdkStatusVersion(SdkStatusCell const* cell) {
+  return cell->sequence.load(std::memory_order_acquire) / 2;
+}
+
+void SdkStatusRead(SdkStatusCell const* cell, SdkStatus* status) {
+  uint64_t language[2];
+  for (;;) {
+    uint64_t before = cell->sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    status->version = before / 2;
+    status->lastResult = cell->lastResult.load(std::memory_order_relaxed);
+    status->readiness = cell->readiness.load(std::memory_order_relaxed);
+    status->permission = cell->permission.load(std::memory_order_relaxed);
+    status->overlayState = cell->overlayState.load(std::memory_order_relaxed);
+    status->overlayOpen = cell->overlayOpen.load(std::memory_order_relaxed);
+    status->numHighlights = cell->numHighlights.load(std::memory_order_relaxed);
+    status->userSettings = cell->userSettings.load(std::memory_order_relaxed);
+    status->numUserSettings = cell->numUserSettings.load(std::memory_order_relaxed);
+    language[0] = cell->language[0].load(std::memory_order_relaxed);
+    language[1] = cell->language[1].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (cell->sequence.load(std::memory_order_relaxed) == before)
+      break;
+  }
+  static_assert(sizeof(language) == sizeof(status->language), "language size");
+  std::memcpy(status->language, language, sizeof(language));
+  status->language[sizeof(status->language) - 1] = '\0';
+}
+
+size_t SdkStatusFormat(SdkStatus const* status, char* buffer, size_t size) {
+  char highlights[16] = "?";
+  if (status->numHighlights >= 0)
+    std::snprintf(highlights, sizeof(highlights), "%d", status->numHighlights);
+  char settings[32] = "?";
+  if (status->numUserSettings >= 0) {
+    int enabled = 0;
+    for (uint64_t bits = status->userSettings; bits; bits &= bits - 1)
+      enabled++;
+    std::snprintf(settings, sizeof(settings), "%d/%d enabled", enabled,
+                  status->numUserSettings);
+  }
+  int written = std::snprintf(
+      buffer, size,
+      "%s, last result %s, permission %s, overlay %s %s, highlights %s, "
+      "settings %s, language %s",
+      SdkReadinessName(status->readiness),
+      NVGSDK_RetCodeToString(static_cast<NVGSDK_RetCode>(status->lastResult)),
+      PermissionName(status->permission), OverlayName(status->overlayState),
+      status->overlayOpen ? "OPEN" : "CLOSED", highlights, settings,
+      status->language[0] ? status->language : "?");
+  if (written < 0)
+    return 0;
+  return static_cast<size_t>(written) < size ? written : size - 1;
+}
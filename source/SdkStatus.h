@@ -0,0 +1,78 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// How far a session got towards accepting highlights. GFE rejects highlights
+// until the table is configured, and videos until their group is open.
+typedef enum {
+  SDK_READINESS_NO_HANDLE,
+  SDK_READINESS_AWAITING_PERMISSION,
+  SDK_READINESS_CONFIGURING,
+  // Configured, waiting for the first group to open
+  SDK_READINESS_OPENING_GROUP,
+  SDK_READINESS_READY,
+  // Permission refused or the highlight table rejected
+  SDK_READINESS_FAILED,
+} SdkReadiness;
+
+char const* SdkReadinessName(int readiness);
+
+// What the SDK callbacks of a session last reported, as plain values. Written
+// by the thread
+// that owns the SDK handle and published through a seqlock, so readers on any
+// thread get a consistent copy without locking and without the callbacks
+// formatting anything. Strings are only built by SdkStatusFormat.
+#define SDK_MAX_USER_SETTINGS 64
+
+typedef struct {
+  // Bumped on every change, readers can skip work when it did not move
+  uint64_t version;
+  // NVGSDK_RetCode of the latest callback
+  int lastResult;
+  // SdkReadiness
+  int readiness;
+  // NVGSDK_Permission of the video highlights scope
+  int permission;
+  // NVGSDK_OverlayState, NVGSDK_OVERLAY_STATE_MAX before any notification
+  int overlayState;
+  bool overlayOpen;
+  // Latest GetNumberOfHighlights answer, -1 until one arrived
+  int numHighlights;
+  // Bit i is clear when GFE lists highlight i of the configured table as
+  // turned off by the user,
+  // valid once numUserSettings >= 0. Only the first SDK_MAX_USER_SETTINGS
+  // highlights have a bit.
+  uint64_t userSettings;
+  int numUserSettings;
+  // Latest GetUILanguage culture code
+  char language[16];
+} SdkStatus;
+
+typedef struct SdkStatusCell SdkStatusCell;
+
+SdkStatusCell* SdkStatusCreate(void);
+void SdkStatusDestroy(SdkStatusCell* cell);
+
+// Writer side, SDK thread only
+void SdkStatusSetResult(SdkStatusCell* cell, int rc);
+void SdkStatusSetPermission(SdkStatusCell* cell, int permission);
+void SdkStatusSetReadiness(SdkStatusCell* cell, int readiness);
+void SdkStatusSetOverlay(SdkStatusCell* cell, int state, bool open);
+void SdkStatusSetNumHighlights(SdkStatusCell* cell, int numHighlights);
+void SdkStatusSetUserSettings(SdkStatusCell* cell, uint64_t enabled, int numSettings);
+void SdkStatusSetLanguage(SdkStatusCell* cell, char const* cultureCode);
+
+// Reader side, any thread
+uint64_t SdkStatusVersion(SdkStatusCell const* cell);
+void SdkStatusRead(SdkStatusCell const* cell, SdkStatus* status);
+// One line description of a snapshot, returns the length written
+size_t SdkStatusFormat(SdkStatus const* status, char* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,608 @@
+#include "SdkWorker.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "Log.h"
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+char const* SdkStartupStateName(SdkStartupState state) {
+  switch (state) {
+    case SdkStartupState::Stopped:
+      return "stopped";
+    case SdkStartupState::Binding:
+      return "binding";
+    case SdkStartupState::Creating:
+      return "creating";
+    case SdkStartupState::Ready:
+      return "ready";
+    case SdkStartupState::Unavailable:
+      return "unavailable";
+  }
+  return "?";
+}
+
+SdkWorker::~SdkWorker() {
+  Stop();
+  if (wrapper)
+    wrapper->DestroySession(session.exchange(nullptr));
+}
+
+void SdkWorker::Start(GfeSdkWrapper* sdkWrapper, SdkInitParams params) {
+  if (running.exchange(true))
+    return;
+  startNs = NowNs();
+  // Readers of the last session's stats are on this thread
+  if (wrapper)
+    wrapper->DestroySession(session.exchange(nullptr));
+  wrapper = sdkWrapper;
+  initParams = std::move(params);
+  // Unknown until the new session reads the user's settings
+  enabledEvents.store(~uint64_t(0), std::memory_order_relaxed);
+  groupOpenFailed = false;
+  bindNs.store(0, std::memory_order_relaxed);
+  createNs.store(0, std::memory_order_relaxed);
+  readyNs.store(0, std::memory_order_relaxed);
+  buffered.store(0, std::memory_order_relaxed);
+  startupState.store(SdkStartupState::Binding, std::memory_order_release);
+  thread = std::thread(&SdkWorker::Run, this);
+  startBlockedNs.store(NowNs() - startNs, std::memory_order_relaxed);
+}
+
+void SdkWorker::Stop() {
+  if (!running.exchange(false))
+    return;
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    wake.notify_one();
+  }
+  thread.join();
+}
+
+bool SdkWorker::OpenGroup(char const* groupId) {
+  SdkCommand command = {};
+  command.type = SdkCommandType::OpenGroup;
+  command.numGroups = 1;
+  command.groupIds[0] = groupId;
+  return Enqueue(command);
+}
+
+bool SdkWorker::CloseGroup(char const* groupId, bool destroy) {
+  SdkCommand command = {};
+  command.type = SdkCommandType::CloseGroup;
+  command.destroyHighlights = destroy;
+  command.numGroups = 1;
+  command.groupIds[0] = groupId;
+  return Enqueue(command);
+}
+
+bool SdkWorker::SaveVideo(char const* highlightId,
+                          char const* groupId,
+                          int startDelta,
+                          int endDelta,
+                          int priority,
+                          int tier) {
+  SdkCommand command = {};
+  command.type = SdkCommandType::SaveVideo;
+  command.highlightId = highlightId;
+  command.numGroups = 1;
+  command.groupIds[0] = groupId;
+  command.startDelta = startDelta;
+  command.endDelta = endDelta;
+  command.priority = priority;
+  command.tier = tier;
+  return Enqueue(command);
+}
+
+bool SdkWorker::OpenSummary(char const* const* groupIds,
+                            size_t numGroups,
+                            int sigFilter,
+                            int tagFilter) {
+  SdkCommand command = {};
+  command.type = SdkCommandType::OpenSummary;
+  command.numGroups = numGroups < kMaxSummaryGroups ? numGroups : kMaxSummaryGroups;
+  std::memcpy(command.groupIds, groupIds, command.numGroups * sizeof(char const*));
+  command.sigFilter = sigFilter;
+  command.tagFilter = tagFilter;
+  return Enqueue(command);
+}
+
+size_t SdkWorker::Discard() {
+  if (running.load())
+    return 0;
+  return queue.Drain([](SdkCommand const&) {});
+}
+
+SdkWorkerStats SdkWorker::Stats() const {
+  SdkWorkerStats stats;
+  stats.depth = queue.Depth();
+  stats.enqueued = enqueued.load(std::memory_order_relaxed);
+  stats.dispatched = dispatched.load(std::memory_order_relaxed);
+  stats.dropped = dropped.load(std::memory_order_relaxed);
+  uint64_t total = latencyTotalNs.load(std::memory_order_relaxed);
+  stats.latencyAvgUs =
+      stats.dispatched ? total / 1000.0 / stats.dispatched : 0.0;
+  stats.latencyMaxUs = latencyMaxNs.load(std::memory_order_relaxed) / 1000.0;
+  stats.polls = pollScheduler.Polls();
+  stats.clips = coalescer.Stats();
+  stats.clipBatches = clipBatches.load(std::memory_order_relaxed);
+  stats.clipBatchFailures = clipBatchFailures.load(std::memory_order_relaxed);
+  stats.retries = retries.Stats();
+  stats.startup.state = StartupState();
+  stats.startup.startBlockedUs =
+      startBlockedNs.load(std::memory_order_relaxed) / 1000.0;
+  stats.startup.bindMs = bindNs.load(std::memory_order_relaxed) / 1e6;
+  stats.startup.createMs = createNs.load(std::memory_order_relaxed) / 1e6;
+  stats.startup.readyMs = readyNs.load(std::memory_order_relaxed) / 1e6;
+  stats.startup.buffered = buffered.load(std::memory_order_relaxed);
+  stats.held.depth = heldDepth.load(std::memory_order_relaxed);
+  stats.held.held = heldTotal.load(std::memory_order_relaxed);
+  stats.held.flushed = heldFlushed.load(std::memory_order_relaxed);
+  stats.held.expired = heldExpired.load(std::memory_order_relaxed);
+  stats.held.overflowed = heldOverflowed.load(std::memory_order_relaxed);
+  stats.held.maxWaitMs = heldMaxWaitNs.load(std::memory_order_relaxed) / 1e6;
+  return stats;
+}
+
+SdkCallStats SdkWorker::CallStats(SdkCallType type) const {
+  GfeSdkSession* current = session.load(std::memory_order_acquire);
+  if (!current)
+    return SdkCallStats{};
+  return GetSdkCallStats(GfeSdkSessionRequests(current), type);
+}
+
+SdkContextPoolStats SdkWorker::ContextPoolStats() const {
+  GfeSdkSession* current = session.load(std::memory_order_acquire);
+  if (!current)
+    return SdkContextPoolStats{};
+  return GetSdkContextPoolStats(GfeSdkSessionContexts(current));
+}
+
+void SdkWorker::Status(SdkStatus* status) const {
+  GfeSdkSession* current = session.load(std::memory_order_acquire);
+  if (!current) {
+    *status = SdkStatus{};
+    return;
+  }
+  SdkStatusRead(GfeSdkSessionStatus(current), status);
+}
+
+size_t SdkWorker::InFlight() const {
+  GfeSdkSession* current = session.load(std::memory_order_acquire);
+  return current ? SdkRequestsInFlight(GfeSdkSessionRequests(current)) : 0;
+}
+
+SdkRequestTable const* SdkWorker::Requests() const {
+  GfeSdkSession* current = session.load(std::memory_order_acquire);
+  return current ? GfeSdkSessionRequests(current) : nullptr;
+}
+
+bool SdkWorker::Enqueue(SdkCommand& command) {
+  command.enqueuedAt = NowNs();
+  if (!queue.TryPush(command)) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    BL_LOG(BL_LOG_ERROR, "SDK command queue full, dropping command %d",
+           static_cast<int>(command.type));
+    return false;
+  }
+  enqueued.fetch_add(1, std::memory_order_relaxed);
+  SdkStartupState state = startupState.load(std::memory_order_relaxed);
+  if (state == SdkStartupState::Binding || state == SdkStartupState::Creating)
+    buffered.fetch_add(1, std::memory_order_relaxed);
+  // Pairs with the fence in WaitForWork: either the worker sees the command
+  // before sleeping or this thread sees it waiting. The lock is only taken when
+  // the worker is idle, so the wakeup cannot slip in before it blocks.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    wake.notify_one();
+  }
+  return true;
+}
+
+void SdkWorker::Run() {
+  // Commands queued until the session is up are dispatched by the loop below
+  bool bound = !initParams.bind || initParams.bind();
+  int64_t bindEnd = NowNs();
+  bindNs.store(bindEnd - startNs, std::memory_order_relaxed);
+  if (!bound)
+    BL_LOG(BL_LOG_ERROR, "GfeSDK could not be loaded, highlights are disabled");
+
+  startupState.store(SdkStartupState::Creating, std::memory_order_release);
+  GfeSdkSession* sdk = wrapper->Init(
+      initParams.gameName.c_str(), initParams.defaultLocale.c_str(),
+      initParams.highlights, initParams.numHighlights,
+      initParams.targetPath.c_str(), initParams.targetPid);
+  session.store(sdk, std::memory_order_release);
+  wrapper->SetCompletionHandler(sdk, &SdkWorker::CallCompleted, this);
+  int64_t readyEnd = NowNs();
+  createNs.store(readyEnd - bindEnd, std::memory_order_relaxed);
+  readyNs.store(readyEnd - startNs, std::memory_order_relaxed);
+  bool open = GfeSdkSessionOpen(sdk);
+  startupState.store(open ? SdkStartupState::Ready : SdkStartupState::Unavailable,
+                     std::memory_order_release);
+  BL_LOG(BL_LOG_INFO,
+         "Nvidia Shadowplay Init() complete: %s after %.0fms, %llu commands buffered",
+         open ? "ready" : "unavailable", (readyEnd - startNs) / 1e6,
+         (unsigned long long)buffered.load(std::memory_order_relaxed));
+  tracked.reserve(kMaxTracked);
+  // Versions start over with the session
+  statusVersion = 0;
+
+  auto dispatch = [this](SdkCommand const& command) { Admit(command); };
+  auto saveClip = [this](ClipRequest const& clip) { SaveClip(clip); };
+  // Init leaves the permission or configure request outstanding
+  pollScheduler.OnSubmitted(PollScheduler::Clock::now());
+  while (running.load()) {
+    size_t drained = queue.Drain(dispatch);
+    auto now = PollScheduler::Clock::now();
+    size_t clips = coalescer.Flush(NowNs(), saveClip);
+    SubmitClips();
+    size_t resubmitted = retries.PopDue(
+        NowNs(), [this](RetryItem const& item) { Resubmit(item); },
+        [this](RetryItem const& item) { GiveUp(item); });
+    SubmitClips();
+    if (drained > 0 || clips > 0 || resubmitted > 0)
+      pollScheduler.OnSubmitted(now);
+    if (pollScheduler.Due(now)) {
+      wrapper->OnTick(sdk);
+      pollScheduler.OnPolled(now, SdkRequestsInFlight(GfeSdkSessionRequests(sdk)));
+      OnStatusChange();
+      ReapBatches();
+      // Readiness only moves in callbacks
+      if (FlushHeld() > 0) {
+        SubmitClips();
+        pollScheduler.OnSubmitted(now);
+      }
+    }
+    if (drained == 0) {
+      auto deadline = pollScheduler.NextPoll();
+      if (coalescer.Depth() > 0) {
+        PollScheduler::Clock::time_point flushAt(
+            std::chrono::duration_cast<PollScheduler::Clock::duration>(
+                std::chrono::nanoseconds(coalescer.NextFlushNs())));
+        if (flushAt < deadline)
+          deadline = flushAt;
+      }
+      if (retries.Depth() > 0) {
+        PollScheduler::Clock::time_point retryAt(
+            std::chrono::duration_cast<PollScheduler::Clock::duration>(
+                std::chrono::nanoseconds(retries.NextDueNs())));
+        if (retryAt < deadline)
+          deadline = retryAt;
+      }
+      WaitForWork(deadline);
+    }
+  }
+  queue.Drain(dispatch);
+  FlushHeld();
+  // The session never got ready for these
+  heldExpired.fetch_add(held.Depth(), std::memory_order_relaxed);
+  held.Clear();
+  heldDepth.store(0, std::memory_order_relaxed);
+  coalescer.FlushAll(saveClip);
+  SubmitClips();
+  wrapper->OnTick(sdk);
+  // Finishes batches whose callbacks did not arrive yet
+  wrapper->DeInit(sdk);
+  ReapBatches();
+  // Nothing is retried past shutdown
+  retries.Clear();
+  tracked.clear();
+  startupState.store(SdkStartupState::Stopped, std::memory_order_release);
+}
+
+void SdkWorker::OnStatusChange() {
+  // Callbacks only store values, the text is built when one of them changed
+  SdkStatusCell const* cell = GfeSdkSessionStatus(session.load(std::memory_order_relaxed));
+  uint64_t version = SdkStatusVersion(cell);
+  if (version == statusVersion)
+    return;
+  statusVersion = version;
+  SdkStatus status;
+  SdkStatusRead(cell, &status);
+  if (status.numUserSettings >= 0)
+    enabledEvents.store(status.userSettings, std::memory_order_relaxed);
+  char line[256];
+  SdkStatusFormat(&status, line, sizeof(line));
+  BL_LOG(BL_LOG_DEBUG, "GFE status: %s", line);
+}
+
+void SdkWorker::Admit(SdkCommand const& command) {
+  // Behind a held command everything waits, order matters between group
+  // calls and clips
+  if (held.Empty() && Accepts(command)) {
+    Dispatch(command);
+    return;
+  }
+  if (!held.Push(command)) {
+    heldOverflowed.fetch_add(1, std::memory_order_relaxed);
+    BL_LOG(BL_LOG_ERROR, "GFE not ready and %zu commands held, dropping one",
+           held.Depth());
+    return;
+  }
+  heldTotal.fetch_add(1, std::memory_order_relaxed);
+  heldDepth.store(held.Depth(), std::memory_order_relaxed);
+}
+
+bool SdkWorker::Accepts(SdkCommand const& command) const {
+  switch (GfeSdkSessionReadiness(session.load(std::memory_order_relaxed))) {
+    case SDK_READINESS_AWAITING_PERMISSION:
+    case SDK_READINESS_CONFIGURING:
+      return false;
+    case SDK_READINESS_OPENING_GROUP:
+      // Clips need their group open as well, unless it never will be
+      return command.type != SdkCommandType::SaveVideo || groupOpenFailed;
+    default:
+      // Ready, or the session never will be and calls fail as they come
+      return true;
+  }
+}
+
+size_t SdkWorker::FlushHeld() {
+  if (held.Empty())
+    return 0;
+  int64_t now = NowNs();
+  int64_t horizon = replayBufferNs.load(std::memory_order_relaxed);
+  size_t expired = held.RemoveIf([&](SdkCommand const& command) {
+    return command.type == SdkCommandType::SaveVideo &&
+           command.enqueuedAt + command.startDelta * int64_t(1000000) + horizon <= now;
+  });
+  if (expired > 0) {
+    heldExpired.fetch_add(expired, std::memory_order_relaxed);
+    BL_LOG(BL_LOG_ERROR, "Dropped %zu highlights that left the replay buffer while GFE was not ready",
+           expired);
+  }
+  size_t flushed = 0;
+  while (!held.Empty() && Accepts(held.Front())) {
+    SdkCommand command = held.Front();
+    held.Pop();
+    // Dispatch takes clip windows from enqueuedAt, so their deltas cover the
+    // time they were held
+    int64_t wait = now - command.enqueuedAt;
+    if (wait > heldMaxWaitNs.load(std::memory_order_relaxed))
+      heldMaxWaitNs.store(wait, std::memory_order_relaxed);
+    Dispatch(command);
+    ++flushed;
+  }
+  heldFlushed.fetch_add(flushed, std::memory_order_relaxed);
+  heldDepth.store(held.Depth(), std::memory_order_relaxed);
+  if (flushed > 0)
+    BL_LOG(BL_LOG_DEBUG, "Sent %zu commands held until GFE was ready", flushed);
+  return flushed;
+}
+
+void SdkWorker::Dispatch(SdkCommand const& command) {
+  GfeSdkSession* sdk = session.load(std::memory_order_relaxed);
+  uint64_t latency = static_cast<uint64_t>(NowNs() - command.enqueuedAt);
+  latencyTotalNs.fetch_add(latency, std::memory_order_relaxed);
+  if (latency > latencyMaxNs.load(std::memory_order_relaxed))
+    latencyMaxNs.store(latency, std::memory_order_relaxed);
+  dispatched.fetch_add(1, std::memory_order_relaxed);
+
+  switch (command.type) {
+    case SdkCommandType::OpenGroup: {
+      RetryItem call = GroupCall(RetryKind::OpenGroup, command.groupIds[0], false);
+      groupOpenFailed = false;
+      Track(wrapper->OnOpenGroup(sdk, command.groupIds[0]), call);
+      break;
+    }
+    case SdkCommandType::CloseGroup:
+      // Held clips belong to the group being closed
+      coalescer.FlushAll([this](ClipRequest const& clip) { SaveClip(clip); });
+      SubmitClips();
+      {
+        RetryItem call = GroupCall(RetryKind::CloseGroup, command.groupIds[0],
+                                   command.destroyHighlights);
+        Track(wrapper->OnCloseGroup(sdk, command.groupIds[0],
+                                    command.destroyHighlights),
+              call);
+      }
+      break;
+    case SdkCommandType::SaveVideo: {
+      int64_t ms = 1000000;
+      ClipRequest clip = {command.highlightId, command.groupIds[0],
+                          command.enqueuedAt + command.startDelta * ms,
+                          command.enqueuedAt + command.endDelta * ms,
+                          command.priority, command.tier};
+      int64_t holdNs = coalesceMs.load(std::memory_order_relaxed) * ms;
+      if (!coalescer.Add(clip, NowNs(), holdNs)) {
+        SaveClip(clip);
+        SubmitClips();
+      }
+      break;
+    }
+    case SdkCommandType::OpenSummary: {
+      // Show clips still being held in the summary
+      coalescer.FlushAll([this](ClipRequest const& clip) { SaveClip(clip); });
+      SubmitClips();
+      char const* groupIds[kMaxSummaryGroups];
+      std::memcpy(groupIds, command.groupIds, sizeof(groupIds));
+      wrapper->OnOpenSummary(sdk, groupIds, command.numGroups,
+                             command.sigFilter, command.tagFilter);
+      break;
+    }
+  }
+}
+
+void SdkWorker::SaveClip(ClipRequest const& clip) {
+  // Collected until SubmitClips, which every flush is followed by
+  if (numClips == kMaxClipBatch)
+    SubmitClips();
+  // GFE takes the window relative to the time of the call
+  int64_t now = NowNs();
+  batchClips[numClips] = clip;
+  clipBatch[numClips++] = {clip.highlightId, clip.groupId,
+                           static_cast<int>((clip.startNs - now) / 1000000),
+                           static_cast<int>((clip.endNs - now) / 1000000)};
+}
+
+void SdkWorker::SubmitClips() {
+  GfeSdkSession* sdk = session.load(std::memory_order_relaxed);
+  if (numClips == 1) {
+    GfeSdkVideoHighlight const& clip = clipBatch[0];
+    RetryItem call = {};
+    call.kind = RetryKind::SaveVideo;
+    call.clip = batchClips[0];
+    call.submittedNs = NowNs();
+    Track(wrapper->OnSaveVideo(sdk, clip.highlightId, clip.groupId,
+                               clip.startDelta, clip.endDelta),
+          call);
+  }
+  else if (numClips > 1) {
+    // One completion for the clips of a flush, checked by ReapBatches
+    PendingBatch pending;
+    pending.batch = wrapper->OnSaveVideoBatch(sdk, clipBatch, numClips);
+    pending.count = numClips;
+    std::copy(batchClips, batchClips + numClips, pending.clips);
+    pending.submittedNs = NowNs();
+    batches.push_back(pending);
+    clipBatches.fetch_add(1, std::memory_order_relaxed);
+  }
+  numClips = 0;
+}
+
+void SdkWorker::ReapBatches() {
+  for (size_t i = 0; i < batches.size();) {
+    PendingBatch const& pending = batches[i];
+    SdkBatch* batch = pending.batch;
+    if (!SdkBatchDone(batch)) {
+      ++i;
+      continue;
+    }
+    size_t failed = SdkBatchFailed(batch);
+    if (failed > 0) {
+      clipBatchFailures.fetch_add(failed, std::memory_order_relaxed);
+      BL_LOG(BL_LOG_ERROR, "%zu of %zu batched video highlights failed", failed,
+             SdkBatchSize(batch));
+      // Retried one by one, the batch as a whole is gone
+      for (size_t j = 0; j < pending.count; ++j) {
+        if (NVGSDK_SUCCEEDED(static_cast<NVGSDK_RetCode>(SdkBatchResult(batch, j))))
+          continue;
+        RetryItem call = {};
+        call.kind = RetryKind::SaveVideo;
+        call.clip = pending.clips[j];
+        call.submittedNs = pending.submittedNs;
+        Retry(call);
+      }
+    }
+    SdkBatchRelease(batch);
+    batches[i] = batches.back();
+    batches.pop_back();
+  }
+}
+
+RetryItem SdkWorker::GroupCall(RetryKind kind, char const* groupId, bool destroy) {
+  RetryItem call = {};
+  call.kind = kind;
+  call.destroyHighlights = destroy;
+  call.clip.groupId = groupId;
+  call.submittedNs = NowNs();
+  // A retry of an older group call would undo this one
+  lastGroupNs = call.submittedNs;
+  retries.DropGroupCalls();
+  return call;
+}
+
+void SdkWorker::Track(uint64_t requestId, RetryItem const& item) {
+  // Zero when the session has no handle, nothing to complete or retry
+  if (requestId == 0)
+    return;
+  if (tracked.size() == kMaxTracked) {
+    // Far more calls outstanding than GFE ever has, its callbacks went missing
+    retries.RecordExpired();
+    tracked.erase(tracked.begin());
+  }
+  tracked.push_back({requestId, item});
+}
+
+void SdkWorker::CallCompleted(void* worker, uint64_t requestId, NVGSDK_RetCode rc) {
+  // Called from OnTick on the worker thread
+  SdkWorker* self = static_cast<SdkWorker*>(worker);
+  auto& tracked = self->tracked;
+  for (size_t i = 0; i < tracked.size(); ++i) {
+    if (tracked[i].requestId != requestId)
+      continue;
+    RetryItem item = tracked[i].item;
+    tracked.erase(tracked.begin() + i);
+    if (!NVGSDK_SUCCEEDED(rc))
+      self->Retry(item);
+    else if (item.attempt > 0)
+      self->retries.RecordRecovered();
+    return;
+  }
+}
+
+void SdkWorker::Retry(RetryItem const& item) {
+  // Failures while shutting down are final
+  if (!running.load(std::memory_order_relaxed)) {
+    retries.RecordExpired();
+    return;
+  }
+  RetryItem call = item;
+  int64_t buffer = replayBufferNs.load(std::memory_order_relaxed);
+  if (call.kind == RetryKind::SaveVideo) {
+    // GFE can only cut the clip while its start is still in the replay buffer
+    call.deadlineNs = call.clip.startNs + buffer;
+  }
+  else {
+    if (call.submittedNs < lastGroupNs) {
+      retries.RecordExpired();
+      return;
+    }
+    call.deadlineNs = call.submittedNs + buffer;
+  }
+  if (!retries.Add(call, NowNs()))
+    GiveUp(call);
+}
+
+void SdkWorker::GiveUp(RetryItem const& item) {
+  // Only the latest group call decides what the group is
+  if (item.kind != RetryKind::OpenGroup || item.submittedNs < lastGroupNs ||
+      groupOpenFailed)
+    return;
+  groupOpenFailed = true;
+  BL_LOG(BL_LOG_ERROR, "Could not open highlights group %s, sending clips without waiting for it",
+         item.clip.groupId);
+}
+
+void SdkWorker::Resubmit(RetryItem const& item) {
+  GfeSdkSession* sdk = session.load(std::memory_order_relaxed);
+  char const* groupId = item.clip.groupId;
+  switch (item.kind) {
+    case RetryKind::OpenGroup:
+      lastGroupNs = item.submittedNs;
+      Track(wrapper->OnOpenGroup(sdk, groupId), item);
+      break;
+    case RetryKind::CloseGroup:
+      lastGroupNs = item.submittedNs;
+      Track(wrapper->OnCloseGroup(sdk, groupId, item.destroyHighlights), item);
+      break;
+    case RetryKind::SaveVideo: {
+      // Deltas are taken again from the clip's absolute window
+      int64_t now = NowNs();
+      Track(wrapper->OnSaveVideo(sdk, item.clip.highlightId, groupId,
+                                 static_cast<int>((item.clip.startNs - now) / 1000000),
+                                 static_cast<int>((item.clip.endNs - now) / 1000000)),
+            item);
+      break;
+    }
+  }
+}
+
+void SdkWorker::WaitForWork(PollScheduler::Clock::time_point deadline) {
+  std::unique_lock<std::mutex> lock(wakeMutex);
+  waiting.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (queue.Depth() == 0 && running.load())
+    wake.wait_until(lock, deadline);
+  waiting.store(false, std::memory_order_relaxed);
+}
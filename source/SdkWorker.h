@@ -0,0 +1,295 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ClipCoalescer.h"
+#include "GfeSDKWrapper.h"
+#include "MpscRing.h"
+#include "PendingBuffer.h"
+#include "PollScheduler.h"
+#include "RetryQueue.h"
+#include "SdkBatch.h"
+#include "SdkContextPool.h"
+#include "SdkRequests.h"
+#include "SdkStatus.h"
+
+enum class SdkCommandType : uint8_t {
+  OpenGroup,
+  CloseGroup,
+  SaveVideo,
+  OpenSummary,
+};
+
+constexpr size_t kMaxSummaryGroups = 4;
+
+// Plain data handed from the hooks to the SDK worker. Strings are not copied
+// and must outlive the command (EventTable names, group id literals).
+struct SdkCommand {
+  SdkCommandType type;
+  bool destroyHighlights;
+  int startDelta;
+  int endDelta;
+  int priority;
+  // HighlightScorer tier, SaveVideo only
+  int tier;
+  int sigFilter;
+  int tagFilter;
+  char const* highlightId;
+  size_t numGroups;
+  char const* groupIds[kMaxSummaryGroups];
+  // steady_clock time of the enqueue, in nanoseconds
+  int64_t enqueuedAt;
+};
+
+struct SdkInitParams {
+  // Binds the NVGSDK_* functions on the worker thread before Init, e.g. by
+  // loading GfeSDK.dll. Returns false when the SDK is unavailable. Empty when
+  // the host bound them already.
+  std::function<bool()> bind;
+  std::string gameName;
+  std::string defaultLocale;
+  NVGSDK_Highlight* highlights;
+  size_t numHighlights;
+  std::string targetPath;
+  int targetPid;
+};
+
+enum class SdkStartupState : uint8_t {
+  Stopped,
+  // Loading GfeSDK and resolving its functions
+  Binding,
+  // NVGSDK_Create handshake with GFE
+  Creating,
+  Ready,
+  // GfeSDK could not be loaded or Create failed, commands are dropped
+  Unavailable,
+};
+
+char const* SdkStartupStateName(SdkStartupState state);
+
+struct SdkStartupStats {
+  SdkStartupState state;
+  // Spent by the caller of Start, i.e. the game thread
+  double startBlockedUs;
+  double bindMs;
+  double createMs;
+  // Start to Ready or Unavailable, zero until then
+  double readyMs;
+  // Commands enqueued before the session was ready, dispatched once it is
+  uint64_t buffered;
+};
+
+struct SdkHeldStats {
+  size_t depth;
+  // Commands held until the session was ready for them, see SdkReadiness
+  uint64_t held;
+  uint64_t flushed;
+  // Clips whose start left the replay buffer while held, or still held at
+  // Stop
+  uint64_t expired;
+  // Dropped because the buffer was full
+  uint64_t overflowed;
+  // Longest a flushed command was held
+  double maxWaitMs;
+};
+
+struct SdkWorkerStats {
+  size_t depth;
+  uint64_t enqueued;
+  uint64_t dispatched;
+  uint64_t dropped;
+  // Enqueue to dispatch latency
+  double latencyAvgUs;
+  double latencyMaxUs;
+  unsigned long long polls;
+  ClipCoalescerStats clips;
+  // Clips flushed together go to the SDK as one batch
+  uint64_t clipBatches;
+  uint64_t clipBatchFailures;
+  RetryQueueStats retries;
+  SdkStartupStats startup;
+  SdkHeldStats held;
+};
+
+// Owns a GfeSDK session on a dedicated thread.
+// Hooks only push small POD commands into a lock-free ring; the worker thread
+// binds the SDK and runs Init, which may block on GFE for seconds, while the
+// ring buffers whatever the hooks send meanwhile. It then drains the ring into
+// the GfeSdkWrapper and runs DeInit on Stop, so the SDK handle and its IPC
+// marshalling never touch the game thread. The same thread polls the SDK for
+// callbacks, as scheduled by a PollScheduler, and merges overlapping video
+// highlights through a ClipCoalescer. Clips released by the same flush are
+// submitted as one SdkBatch. Until the session is configured and has a group
+// open, commands are held in order and clips that age out of the replay buffer
+// are dropped, unless the group failed to open for good. Failed video highlight
+// and group calls go through a RetryQueue. Each worker has its own session, so
+// workers share no request or status state.
+class SdkWorker {
+ public:
+  ~SdkWorker();
+
+  // Returns right away, see StartupState for when the session is ready
+  void Start(GfeSdkWrapper* wrapper, SdkInitParams params);
+  // Dispatches whatever is still queued, then releases the SDK
+  void Stop();
+
+  void SetPollIntervals(std::chrono::milliseconds busy,
+                        std::chrono::milliseconds idle) {
+    pollScheduler.SetIntervals(busy, idle);
+  }
+  // How long video highlights are held for merging, zero sends them right away
+  void SetCoalesceWindow(std::chrono::milliseconds window) {
+    coalesceMs.store(static_cast<int>(window.count()), std::memory_order_relaxed);
+  }
+  // Length of GFE's replay buffer. A failed clip is retried until its start
+  // has left the buffer, a failed group call for as long.
+  void SetReplayBuffer(std::chrono::seconds length) {
+    replayBufferNs.store(std::chrono::nanoseconds(length).count(),
+                         std::memory_order_relaxed);
+  }
+
+  // Enqueue functions return false when the queue is full and the command was dropped
+  bool OpenGroup(char const* groupId);
+  bool CloseGroup(char const* groupId, bool destroy);
+  bool SaveVideo(char const* highlightId,
+                 char const* groupId,
+                 int startDelta,
+                 int endDelta,
+                 int priority,
+                 int tier);
+  bool OpenSummary(char const* const* groupIds,
+                   size_t numGroups,
+                   int sigFilter,
+                   int tagFilter);
+
+  // Drops every queued command without dispatching it. Only valid while the
+  // worker thread is not running.
+  size_t Discard();
+
+  SdkWorkerStats Stats() const;
+  // False when the user turned the highlight of slot i of the table given to
+  // Init off in GFE. True until GFE reported the settings, and for slots past
+  // the 64 the settings cover. Any thread.
+  bool EventEnabled(int slot) const {
+    return slot >= SDK_MAX_USER_SETTINGS ||
+           ((enabledEvents.load(std::memory_order_relaxed) >> slot) & 1) != 0;
+  }
+  SdkStartupState StartupState() const {
+    return startupState.load(std::memory_order_acquire);
+  }
+  // Of the current or last session, zero before the first Init
+  SdkCallStats CallStats(SdkCallType type) const;
+  SdkContextPoolStats ContextPoolStats() const;
+  void Status(SdkStatus* status) const;
+  size_t InFlight() const;
+  // Request table of the current or last session, null before the first Init.
+  // Valid until the next Start.
+  SdkRequestTable const* Requests() const;
+
+ private:
+  static constexpr size_t kQueueCapacity = 256;
+  static constexpr size_t kMaxClipBatch = 16;
+  // Calls followed for a retry, about the SDK requests there can be in flight
+  static constexpr size_t kMaxTracked = 256;
+  static constexpr size_t kMaxHeld = 256;
+
+  struct PendingBatch {
+    SdkBatch* batch;
+    size_t count;
+    int64_t submittedNs;
+    ClipRequest clips[kMaxClipBatch];
+  };
+
+  struct TrackedCall {
+    uint64_t requestId;
+    RetryItem item;
+  };
+
+  bool Enqueue(SdkCommand& command);
+  void Run();
+  // Dispatches the command or holds it until the session accepts it
+  void Admit(SdkCommand const& command);
+  bool Accepts(SdkCommand const& command) const;
+  // Drops held clips past the replay buffer and dispatches the held commands
+  // the session accepts now, returns how many
+  size_t FlushHeld();
+  void Dispatch(SdkCommand const& command);
+  void SaveClip(ClipRequest const& clip);
+  void SubmitClips();
+  void ReapBatches();
+  // Completion handler of the session, see GfeSdkCompletionHandler
+  static void CallCompleted(void* worker, uint64_t requestId, NVGSDK_RetCode rc);
+  void Track(uint64_t requestId, RetryItem const& item);
+  void Retry(RetryItem const& item);
+  void Resubmit(RetryItem const& item);
+  // A call that will not be tried again
+  void GiveUp(RetryItem const& item);
+  RetryItem GroupCall(RetryKind kind, char const* groupId, bool destroy);
+  void WaitForWork(PollScheduler::Clock::time_point deadline);
+  // Logs a changed status and caches the user's highlight settings
+  void OnStatusChange();
+
+  GfeSdkWrapper* wrapper = nullptr;
+  // Set by the worker thread once Init returns. Kept after DeInit so stats
+  // stay readable, destroyed by the next Start or the destructor.
+  std::atomic<GfeSdkSession*> session{nullptr};
+  SdkInitParams initParams;
+  MpscRing<SdkCommand, kQueueCapacity> queue;
+  std::thread thread;
+  std::atomic<bool> running{false};
+  std::atomic<SdkStartupState> startupState{SdkStartupState::Stopped};
+  int64_t startNs = 0;
+  std::atomic<int64_t> startBlockedNs{0};
+  std::atomic<int64_t> bindNs{0};
+  std::atomic<int64_t> createNs{0};
+  std::atomic<int64_t> readyNs{0};
+  std::atomic<uint64_t> buffered{0};
+  PollScheduler pollScheduler;
+  ClipCoalescer coalescer;
+  std::atomic<int> coalesceMs{0};
+  // SdkStatus userSettings as of the last status change
+  std::atomic<uint64_t> enabledEvents{~uint64_t(0)};
+  // SdkStatus version last logged, worker thread only
+  uint64_t statusVersion = 0;
+  // Clips of the current flush and the batches not completed yet, worker
+  // thread only
+  GfeSdkVideoHighlight clipBatch[kMaxClipBatch];
+  ClipRequest batchClips[kMaxClipBatch];
+  size_t numClips = 0;
+  std::vector<PendingBatch> batches;
+  // Submitted calls that can be retried, worker thread only
+  std::vector<TrackedCall> tracked;
+  RetryQueue retries;
+  // Submission time of the last group call, older group calls are stale
+  int64_t lastGroupNs = 0;
+  // The latest OpenGroup failed for good, so clips no longer wait for their
+  // group and fail at GFE instead. Worker thread only.
+  bool groupOpenFailed = false;
+  std::atomic<int64_t> replayBufferNs{300000000000};
+  // Commands waiting for the session to be ready, worker thread only
+  PendingBuffer<SdkCommand, kMaxHeld> held;
+
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  std::atomic<bool> waiting{false};
+
+  std::atomic<uint64_t> enqueued{0};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint64_t> dispatched{0};
+  std::atomic<uint64_t> latencyTotalNs{0};
+  std::atomic<uint64_t> latencyMaxNs{0};
+  std::atomic<uint64_t> clipBatches{0};
+  std::atomic<uint64_t> clipBatchFailures{0};
+  std::atomic<size_t> heldDepth{0};
+  std::atomic<uint64_t> heldTotal{0};
+  std::atomic<uint64_t> heldFlushed{0};
+  std::atomic<uint64_t> heldExpired{0};
+  std::atomic<uint64_t> heldOverflowed{0};
+  std::atomic<int64_t> heldMaxWaitNs{0};
+};
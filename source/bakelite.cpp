@@ -1,8 +1,16 @@
 #include "bakelite.h"
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
-#include <sstream>
 #include <string>
+#include "AllocCounter.h"
+#include "Bench.h"
 #include "GfeSDKWrapper.h"
+#include "HighlightCore.h"
+#include "Log.h"
 #include "Maps.h"
 #include "bakkesmod/wrappers/includes.h"
 
@@ -15,8 +23,6 @@
 
 using namespace std;
 
-char const* GROUP1_ID = "GROUP1";
-
 int PGUP_KEY = 17506;
 int PGDN_KEY = 17507;
 int END_KEY = 8216;
@@ -26,13 +32,6 @@ BAKKESMOD_PLUGIN(Bakelite,
 	"1.1",
 	PLUGINTYPE_FREEPLAY)
 
-	struct HighlightsDataHolder {
-	bool relevant;
-	int startDelta;
-	int endDelta;
-	std::chrono::system_clock::time_point lastCapture;
-};
-
 struct FNameStruct {
 	int Index;
 	int Number;
@@ -51,88 +50,20 @@ struct KeyInfo {
 	bool isPressed;
 };
 
-struct HighlightsData {
-	std::string gameName;
-	std::string defaultLocale;
-	std::map<std::string, HighlightsDataHolder> highlightsData{
-		{"Goal", {true, -5000, 3000, std::chrono::system_clock::now()}},
-		{"EpicSave", {true, -5000, 3000, std::chrono::system_clock::now()}},
-		{"Save", {true, -5000, 3000, std::chrono::system_clock::now()}},
-		{"HighFive", {true, -5000, 3000, std::chrono::system_clock::now()}},
-		{"Assist", {true, -8000, 5000, std::chrono::system_clock::now()}},
-		{"Demolish", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"Demolition", {false, -2000, 3000, std::chrono::system_clock::now()}},
-		{"Win", {false, 0, 3000, std::chrono::system_clock::now()}},
-		{"MVP", {false, 0, 3000, std::chrono::system_clock::now()}},
-		{"AerialGoal", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"BackwardsGoal", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"BicycleGoal", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"LongGoal", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"TurtleGoal", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"PoolShot", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"OvertimeGoal", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"HatTrick", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"Playmaker", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"Savior", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"Shot", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"Center", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"Clear", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"FirstTouch", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"BreakoutDamage",
-		 {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"BreakoutDamageLarge",
-		 {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"LowFive", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"HoopsSwishGoal",
-		 {false, -5000, 3000, std::chrono::system_clock::now()}},
-		{"BicycleHit", {false, -5000, 3000, std::chrono::system_clock::now()}},
-		  {"OwnGoal", {true, -5000, 3000, std::chrono::system_clock::now()}},
-		{"PlayerEvent", {true, -10000, 2000, std::chrono::system_clock::now()}} };
-
-	std::vector<NVGSDK_Highlight> highlights;
-};
-
-GfeSdkWrapper g_highlights;
-HighlightsData g_highlightsConfig;
-
-void Bakelite::LoadHighlightConfig() {
-	cvarManager->log("Initializing Nvidia Geforce Experience Wrapper.");
-	InitGfeSdkWrapper(&g_highlights);
-	g_highlightsConfig.gameName = "Rocket League";
-	// TODO: Support user locale
-	g_highlightsConfig.defaultLocale = "en-US";
-
-	g_highlightsConfig.highlights.resize(
-		g_highlightsConfig.highlightsData.size());
-
-	int i = 0;
-	for (auto const& [key, val] : g_highlightsConfig.highlightsData) {
-		g_highlightsConfig.highlights[i].id = key.c_str();
-		g_highlightsConfig.highlights[i].userInterest = val.relevant;
-		// TODO: Figure out relevance of these 2
-		g_highlightsConfig.highlights[i].significance =
-			static_cast<NVGSDK_HighlightSignificance>(3);
-		g_highlightsConfig.highlights[i].highlightTags =
-			static_cast<NVGSDK_HighlightType>(0);
-		g_highlightsConfig.highlights[i].nameTable = nullptr;
-		g_highlightsConfig.highlights[i].nameTableSize = 0;
-		ostringstream os;
-		os << "Event enabled: " << key.c_str() << " [" << val.startDelta << "ms/"
-			<< val.endDelta << "ms]";
-		cvarManager->log(os.str());
-		i++;
-	}
+static std::string ResolveStatEventName(uintptr_t statEvent) {
+	return StatEventWrapper(statEvent).GetEventName();
 }
 
-void Bakelite::LoadGfeSDK() {
-	std::string dllPath = gameWrapper->GetDataFolder().string() + "\\bakelite\\GfeSDK.dll";
+HighlightCore g_core(&ResolveStatEventName);
+
+// Runs on the SDK worker thread, loading the DLL can take a while
+static bool LoadGfeSDK(std::string const& dllPath) {
 	HINSTANCE hGetProcIDDLL = LoadLibrary(dllPath.c_str());
 	if (!hGetProcIDDLL) {
-		cvarManager->log("Failed to load GfeSDK.dll");
-	}
-	else {
-		cvarManager->log("Loaded GfeSDK.dll");
+		BL_LOG(BL_LOG_ERROR, "Failed to load GfeSDK.dll");
+		return false;
 	}
+	BL_LOG(BL_LOG_INFO, "Loaded GfeSDK.dll");
 	NVGSDK_Create =
 		(NVGSDK_Createfn)GetProcAddress(hGetProcIDDLL, "NVGSDK_Create");
 	NVGSDK_Release =
@@ -165,21 +96,50 @@ void Bakelite::LoadGfeSDK() {
 		(NVGSDK_Highlights_OpenSummaryAsyncfn)GetProcAddress(hGetProcIDDLL, "NVGSDK_Highlights_OpenSummaryAsync");
 	NVGSDK_Highlights_GetNumberOfHighlightsAsync =
 		(NVGSDK_Highlights_GetNumberOfHighlightsAsyncfn)GetProcAddress(hGetProcIDDLL, "NVGSDK_Highlights_GetNumberOfHighlightsAsync");
-	return;
+	return NVGSDK_Create != nullptr;
+}
+
+// Console arguments are user input, so these fail instead of throwing
+static bool ParseDouble(std::string const& text, double* value) {
+	char* end = nullptr;
+	errno = 0;
+	double parsed = strtod(text.c_str(), &end);
+	if (text.empty() || *end != '\0' || errno == ERANGE || !std::isfinite(parsed))
+		return false;
+	*value = parsed;
+	return true;
+}
+
+static bool ParseInt(std::string const& text, int* value) {
+	char* end = nullptr;
+	errno = 0;
+	long parsed = strtol(text.c_str(), &end, 10);
+	if (text.empty() || *end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX)
+		return false;
+	*value = static_cast<int>(parsed);
+	return true;
+}
+
+// The console is game thread only, so records are drained from a game thread
+// tick with LogFlush rather than by the background flusher
+static void ConsoleLogSink(BL_LogLevel, char const* text, void* context) {
+	static_cast<CVarManagerWrapper*>(context)->log(text);
 }
 
 void Bakelite::onLoad() {
-	Bakelite::LoadGfeSDK();
-	Bakelite::LoadHighlightConfig();
-	bEnabled = std::make_shared<bool>(false);
+	auto loadStart = std::chrono::steady_clock::now();
+	LogSetSink(&ConsoleLogSink, cvarManager.get());
+	g_core.LoadConfig();
+	g_core.SetTeamResolver([](uintptr_t pri) { return static_cast<int>(PriWrapper(pri).GetTeamNum()); });
 	bShowSummaryOnExit = std::make_shared<bool>(true);
 	bClearHighlightsOnNewMatch = std::make_shared<bool>(true);
 
-	fDelay = std::make_shared<float>(3.f);
 	cvarManager
 		->registerCvar("BL_Enable", "1", "Trigger Nvidia Highlights", true, true,
 			0, true, 1)
-		.bindTo(bEnabled);
+		.addOnValueChanged([](std::string oldValue, CVarWrapper cvar) {
+			g_core.SetEnabled(cvar.getBoolValue());
+		});
 	cvarManager
 		->registerCvar("BL_ShowSummaryOnExit", "0", "Show Nvidia Highlights summary on match exit", true, true,
 			0, true, 1)
@@ -188,18 +148,289 @@ void Bakelite::onLoad() {
 		->registerCvar("BL_ClearHighlightsOnNewMatch", "0",
 			"Delete existing unsaved highlights when new match starts", true, true,
 			0, true, 1)
-		.bindTo(bShowSummaryOnExit);
+		.bindTo(bClearHighlightsOnNewMatch);
 	cvarManager
 		->registerCvar("BL_Delay", "3.0", "Delay between recordings of same type", true, true,
 			0.0, true, 10.0)
-		.bindTo(fDelay);
-
+		.addOnValueChanged([](std::string oldValue, CVarWrapper cvar) {
+			g_core.SetEventDelay(cvar.getFloatValue());
+		});
+	cvarManager
+		->registerCvar("BL_GlobalRate", "2.0", "Highlight requests per second sent to GFE across all events (0 = unlimited)", true, true,
+			0.0, true, 20.0)
+		.addOnValueChanged([this](std::string oldValue, CVarWrapper cvar) { ApplyRateLimits(); });
+	cvarManager
+		->registerCvar("BL_GlobalBurst", "4", "Highlight requests GFE may receive back to back", true, true,
+			1, true, 20)
+		.addOnValueChanged([this](std::string oldValue, CVarWrapper cvar) { ApplyRateLimits(); });
+	cvarManager
+		->registerCvar("BL_LogLevel", "2", "Console log level (0 off, 1 error, 2 info, 3 debug, 4 trace)", true, true,
+			0, true, 4)
+		.addOnValueChanged([](std::string oldValue, CVarWrapper cvar) {
+			LogSetLevel(cvar.getIntValue());
+		});
+	cvarManager
+		->registerCvar("BL_PollBusyMs", "5", "SDK callback poll interval while requests are in flight (ms)", true, true,
+			1, true, 100)
+		.addOnValueChanged([this](std::string oldValue, CVarWrapper cvar) { ApplyPollIntervals(); });
+	cvarManager
+		->registerCvar("BL_PollIdleMs", "250", "SDK callback poll interval while idle (ms)", true, true,
+			10, true, 2000)
+		.addOnValueChanged([this](std::string oldValue, CVarWrapper cvar) { ApplyPollIntervals(); });
+	cvarManager
+		->registerCvar("BL_CoalesceMs", "2000", "Hold highlights this long to merge overlapping clips (ms, 0 = off)", true, true,
+			0, true, 3000)
+		.addOnValueChanged([](std::string oldValue, CVarWrapper cvar) {
+			g_core.SetCoalesceWindow(std::chrono::milliseconds(cvar.getIntValue()));
+		});
+	cvarManager
+		->registerCvar("BL_ReplayBufferSec", "300", "Length of GFE's instant replay buffer, failed highlights are retried while their start is inside it (s)", true, true,
+			15, true, 1200)
+		.addOnValueChanged([](std::string oldValue, CVarWrapper cvar) {
+			g_core.SetReplayBuffer(std::chrono::seconds(cvar.getIntValue()));
+		});
+	cvarManager
+		->registerCvar("BL_MinSignificance", "-3", "Skip highlights scored below this (-3 extremely bad .. 3 extremely good, -3 = keep all)", true, true,
+			-3, true, 3)
+		.addOnValueChanged([](std::string oldValue, CVarWrapper cvar) {
+			g_core.SetMinSignificance(cvar.getIntValue());
+		});
+	cvarManager
+		->registerCvar("BL_SummarySignificance", "-3", "Summary only shows highlights of this significance and above (-3 = all)", true, true,
+			-3, true, 3)
+		.addOnValueChanged([](std::string oldValue, CVarWrapper cvar) {
+			g_core.SetSummarySignificance(cvar.getIntValue());
+		});
+	g_core.SetEnabled(cvarManager->getCvar("BL_Enable").getBoolValue());
+	g_core.SetMinSignificance(cvarManager->getCvar("BL_MinSignificance").getIntValue());
+	g_core.SetSummarySignificance(cvarManager->getCvar("BL_SummarySignificance").getIntValue());
+	g_core.SetEventDelay(cvarManager->getCvar("BL_Delay").getFloatValue());
+	g_core.SetCoalesceWindow(
+		std::chrono::milliseconds(cvarManager->getCvar("BL_CoalesceMs").getIntValue()));
+	g_core.SetReplayBuffer(
+		std::chrono::seconds(cvarManager->getCvar("BL_ReplayBufferSec").getIntValue()));
+	ApplyPollIntervals();
+	ApplyRateLimits();
+	// Fixed size, so this costs the same however long the stats were kept
+	g_core.OpenLifetimeStats(gameWrapper->GetDataFolder().string() + "\\bakelite\\stats.bin");
+	cvarManager->registerNotifier("bakelite_event_limit",
+		[this](std::vector<std::string> params) {
+			if (params.size() < 3) {
+				cvarManager->log("Usage: bakelite_event_limit <event> <per second|default> [burst]");
+				return;
+			}
+			std::optional<RateLimit> limit;
+			if (params[2] != "default") {
+				double rate = 0;
+				double burst = 1.0;
+				if (!ParseDouble(params[2], &rate) || rate < 0
+					|| (params.size() > 3 && (!ParseDouble(params[3], &burst) || (rate > 0 && burst < 1)))) {
+					cvarManager->log("Usage: bakelite_event_limit <event> <per second|default> [burst]");
+					return;
+				}
+				limit = RateLimit{ rate, burst };
+			}
+			if (!g_core.SetEventLimit(params[1], limit))
+				cvarManager->log("Unknown event: " + params[1]);
+		},
+		"Override the capture rate of one event. Usage: bakelite_event_limit <event> <per second|default> [burst]",
+		PERMISSION_ALL);
+	cvarManager->registerNotifier("bakelite_capture",
+		[this](std::vector<std::string> params) {
+			if (params.size() > 1 && params[1] == "stop") {
+				size_t records = g_core.StopCapture();
+				cvarManager->log("Capture stopped, " + std::to_string(records) + " records");
+				return;
+			}
+			std::string path = params.size() > 2 ? params[2]
+				: gameWrapper->GetDataFolder().string() + "\\bakelite\\capture.blcap";
+			if (g_core.StartCapture(path))
+				cvarManager->log("Capturing events to " + path);
+		},
+		"Record stat events, hotkeys, matches, the game clock and score for bakelite_replay. Usage: bakelite_capture start [file] | stop",
+		PERMISSION_ALL);
+	cvarManager->registerNotifier("bakelite_bench",
+		[this](std::vector<std::string> params) {
+			std::string mode = params.size() > 1 ? params[1] : "core";
+			int iterations = 100000;
+			if (params.size() > 2 && (!ParseInt(params[2], &iterations) || iterations <= 0)) {
+				cvarManager->log("Usage: bakelite_bench [core|alloc] [iterations] [json]");
+				return;
+			}
+			if (mode == "alloc") {
+				size_t allocations = g_core.CountHotPathAllocations(iterations);
+				char line[160];
+				snprintf(line, sizeof(line), "alloc: %s, %zu allocations over %d stat events",
+					allocations == 0 ? "PASS" : "FAIL", allocations, iterations);
+				cvarManager->log(line);
+			}
+			else {
+				std::vector<BenchResult> results =
+					RunCoreBenchmarks(g_core.Events(), iterations, &ThreadAllocationCount);
+				if (params.size() > 3 && params[3] == "json") {
+					cvarManager->log(BenchResultsToJson(results));
+				}
+				else {
+					for (BenchResult const& result : results)
+						cvarManager->log(FormatBenchResult(result));
+				}
+			}
+		},
+		"Measure the stat event hot path. Usage: bakelite_bench [core|alloc] [iterations] [json]",
+		PERMISSION_ALL);
+	cvarManager->registerNotifier("bakelite_stats",
+		[this](std::vector<std::string> params) {
+			SdkWorkerStats stats = g_core.WorkerStats();
+			char line[200];
+			snprintf(line, sizeof(line),
+				"sdk queue: depth %zu, enqueued %llu, dispatched %llu, dropped %llu, latency avg %.1fus max %.1fus, polls %llu",
+				stats.depth, (unsigned long long)stats.enqueued,
+				(unsigned long long)stats.dispatched, (unsigned long long)stats.dropped,
+				stats.latencyAvgUs, stats.latencyMaxUs, stats.polls);
+			cvarManager->log(line);
+			snprintf(line, sizeof(line),
+				"clip coalescing: %llu requests -> %llu clips, %.1fs of video saved, %llu batches, %llu batched failures",
+				(unsigned long long)stats.clips.requests, (unsigned long long)stats.clips.clips,
+				stats.clips.savedMs / 1000.0, (unsigned long long)stats.clipBatches,
+				(unsigned long long)stats.clipBatchFailures);
+			cvarManager->log(line);
+			snprintf(line, sizeof(line),
+				"retries: queued %llu, resubmitted %llu, recovered %llu, dropped %llu, expired %llu, depth %zu",
+				(unsigned long long)stats.retries.queued, (unsigned long long)stats.retries.resubmitted,
+				(unsigned long long)stats.retries.recovered, (unsigned long long)stats.retries.dropped,
+				(unsigned long long)stats.retries.expired, stats.retries.depth);
+			cvarManager->log(line);
+			snprintf(line, sizeof(line),
+				"startup: %s after %.0fms (bind %.0fms, create %.0fms), %llu commands buffered, game thread blocked %.0fus (start %.0fus)",
+				SdkStartupStateName(stats.startup.state), stats.startup.readyMs,
+				stats.startup.bindMs, stats.startup.createMs,
+				(unsigned long long)stats.startup.buffered, loadBlockedUs,
+				stats.startup.startBlockedUs);
+			cvarManager->log(line);
+			snprintf(line, sizeof(line),
+				"held until GFE ready: %llu, flushed %llu, expired %llu, overflowed %llu, depth %zu, max wait %.0fms",
+				(unsigned long long)stats.held.held, (unsigned long long)stats.held.flushed,
+				(unsigned long long)stats.held.expired, (unsigned long long)stats.held.overflowed,
+				stats.held.depth, stats.held.maxWaitMs);
+			cvarManager->log(line);
+			snprintf(line, sizeof(line), "events turned off in GFE: %llu skipped",
+				(unsigned long long)g_core.DisabledSkipped());
+			cvarManager->log(line);
+			for (int type = 0; type < SDK_CALL_COUNT; type++) {
+				SdkCallStats call = g_core.CallStats(static_cast<SdkCallType>(type));
+				if (call.submitted == 0)
+					continue;
+				snprintf(line, sizeof(line),
+					"%s: submitted %llu, ok %llu, failed %llu, in flight %llu, callback p50 %.0fus p99 %.0fus max %.0fus",
+					SdkCallTypeName(static_cast<SdkCallType>(type)),
+					(unsigned long long)call.submitted, (unsigned long long)call.succeeded,
+					(unsigned long long)call.failed, (unsigned long long)call.inFlight,
+					call.p50Us, call.p99Us, call.maxUs);
+				cvarManager->log(line);
+			}
+			SdkStatus status;
+			g_core.Status(&status);
+			char statusLine[256];
+			SdkStatusFormat(&status, statusLine, sizeof(statusLine));
+			cvarManager->log(std::string("gfe status: ") + statusLine);
+			SdkContextPoolStats pool = g_core.ContextPoolStats();
+			snprintf(line, sizeof(line),
+				"context pool: %zu/%zu slots in use, high water %zu, exhausted %llu, oversized %llu",
+				pool.inUse, pool.capacity, pool.highWater,
+				(unsigned long long)pool.exhausted, (unsigned long long)pool.oversized);
+			cvarManager->log(line);
+			RateLimiter const& limiter = g_core.Limiter();
+			RateLimiterStats limits = limiter.Stats();
+			snprintf(line, sizeof(line),
+				"rate limiter: admitted %llu, throttled per event %llu, throttled global %llu",
+				(unsigned long long)limits.admitted, (unsigned long long)limits.throttledEvent,
+				(unsigned long long)limits.throttledGlobal);
+			cvarManager->log(line);
+			EventTable const& table = g_core.Events();
+			for (int slot = 0; slot < static_cast<int>(table.size()); slot++) {
+				RateLimiterStats event = limiter.EventStats(slot);
+				if (event.admitted + event.throttledEvent + event.throttledGlobal == 0)
+					continue;
+				snprintf(line, sizeof(line), "  %s: admitted %llu, throttled %llu/%llu",
+					table.Name(slot).c_str(), (unsigned long long)event.admitted,
+					(unsigned long long)event.throttledEvent,
+					(unsigned long long)event.throttledGlobal);
+				cvarManager->log(line);
+			}
+		},
+		"Print SDK command queue, callback latency and rate limiter statistics",
+		PERMISSION_ALL);
+	cvarManager->registerNotifier("bakelite_requests",
+		[this](std::vector<std::string> params) {
+			SdkRequestTable const* requests = g_core.Requests();
+			if (!requests) {
+				cvarManager->log("GfeSDK session not started");
+				return;
+			}
+			auto retCodeName = [](int rc) {
+				return NVGSDK_RetCodeToString(static_cast<NVGSDK_RetCode>(rc));
+			};
+			for (std::string const& line : SdkRequestReport(requests, retCodeName))
+				cvarManager->log(line);
+		},
+		"Print every GfeSDK call type's counters, latency percentiles and failures by return code, and the oldest requests in flight",
+		PERMISSION_ALL);
+	cvarManager->registerNotifier("bakelite_match_stats",
+		[this](std::vector<std::string> params) {
+			bool current = g_core.MatchStats().Players() > 0;
+			PlayerStatStore const& match = current ? g_core.MatchStats() : g_core.LastMatchStats();
+			cvarManager->log(std::string(current ? "Current" : "Last") + " match, " +
+				std::to_string(match.Players()) + " players");
+			for (int row = 0; row < match.Players(); row++) {
+				std::string line = "  player " + std::to_string(row + 1) + ":";
+				// The game columns repeat these for a single match
+				for (int stat = 0; stat < startGameStats; stat++) {
+					if (stat == games || match.GetRow(row, stat) == 0)
+						continue;
+					line += " ";
+					line += indexStringMapRender[stat];
+					line += std::to_string(match.GetRow(row, stat));
+				}
+				cvarManager->log(line);
+			}
+		},
+		"Print the stats of every player in the current match, or the last one between matches",
+		PERMISSION_ALL);
+	cvarManager->registerNotifier("bakelite_lifetime_stats",
+		[this](std::vector<std::string> params) {
+			LifetimeStatStore const& store = g_core.LifetimeStats();
+			if (!store.IsOpen()) {
+				cvarManager->log("Stat file not open");
+				return;
+			}
+			cvarManager->log(std::string("Stat file ") + LifetimeStatsOpenName(store.OpenResult()) +
+				", session " + std::to_string(store.Sessions()) + ", " +
+				std::to_string(store.Syncs()) + " syncs");
+			for (int stat = 0; stat < startGameStats; stat++) {
+				if (store.Lifetime(stat) == 0)
+					continue;
+				cvarManager->log("  " + std::string(indexStringMapRender[stat]) +
+					std::to_string(store.Lifetime(stat)) + " (this session " +
+					std::to_string(store.Session(stat)) + ")");
+			}
+		},
+		"Print your lifetime and this session's stat totals",
+		PERMISSION_ALL);
 
+	gameWrapper->HookEvent("Function Engine.GameViewportClient.Tick",
+		[](std::string) { LogFlush(); });
 	// Called when icon event happens for player
 	gameWrapper->HookEventWithCallerPost<ServerWrapper>(
 		"Function TAGame.GFxHUD_TA.HandleStatEvent",
 		std::bind(&Bakelite::OnStatEvent, this, std::placeholders::_1,
 			std::placeholders::_2));
+	gameWrapper->HookEventWithCallerPost<ServerWrapper>(
+		"Function TAGame.GameEvent_Soccar_TA.OnGameTimeUpdated",
+		[this](ServerWrapper caller, void*, std::string) { OnGameTimeUpdated(caller); });
+	// Called at every kickoff, once the score of the previous goal is counted
+	gameWrapper->HookEventWithCallerPost<ServerWrapper>(
+		"Function GameEvent_Soccar_TA.Countdown.BeginState",
+		[this](ServerWrapper caller, void*, std::string) { OnKickoff(caller); });
 	// Called when exiting stats screen
 	gameWrapper->HookEvent("Function TAGame.GameEvent_TA.Destroyed",
 		std::bind(&Bakelite::OnMatchExit, this));
@@ -215,101 +446,103 @@ void Bakelite::onLoad() {
 		std::bind(&Bakelite::OnKeyPressed, this,
 			std::placeholders::_1, std::placeholders::_2,
 			std::placeholders::_3));
-	cvarManager->log("Nvidia Shadowplay Init()");
-	g_highlights.Init(g_highlightsConfig.gameName.c_str(),
-		g_highlightsConfig.defaultLocale.c_str(),
-		&g_highlightsConfig.highlights[0],
-		g_highlightsConfig.highlights.size(), gameWrapper->GetBakkesModPath().string().c_str(),
-		GetCurrentProcessId());
-	cvarManager->log("Nvidia Shadowplay Init() complete.");
-	cvarManager->log("Bakelite ready!");
-	// Open group now
-	g_highlights.OnOpenGroup(GROUP1_ID);
+	// GfeSDK is loaded and created on the worker, events are queued until then
+	std::string dllPath = gameWrapper->GetDataFolder().string() + "\\bakelite\\GfeSDK.dll";
+	g_core.Start(gameWrapper->GetBakkesModPath().string(),
+		static_cast<int>(GetCurrentProcessId()),
+		[dllPath]() { return LoadGfeSDK(dllPath); });
+	loadBlockedUs = std::chrono::duration<double, std::micro>(
+		std::chrono::steady_clock::now() - loadStart).count();
+	BL_LOG(BL_LOG_INFO, "Bakelite ready!");
+	LogFlush();
+}
+
+void Bakelite::ApplyPollIntervals() {
+	g_core.SetPollIntervals(
+		std::chrono::milliseconds(cvarManager->getCvar("BL_PollBusyMs").getIntValue()),
+		std::chrono::milliseconds(cvarManager->getCvar("BL_PollIdleMs").getIntValue()));
+}
+
+void Bakelite::ApplyRateLimits() {
+	g_core.SetGlobalLimit(
+		RateLimit{ cvarManager->getCvar("BL_GlobalRate").getFloatValue(),
+			static_cast<double>(cvarManager->getCvar("BL_GlobalBurst").getIntValue()) });
 }
 
 void Bakelite::onUnload() {
-	cvarManager->log("Nvidia Shadowplay DeInit()");
-	g_highlights.DeInit();
-	cvarManager->log("Nvidia Shadowplay DeInit complete.");
+	g_core.Stop();
+	g_core.CloseLifetimeStats();
+	LogFlush();
 }
 void Bakelite::OnKeyPressed(ActorWrapper aw,
 	void* params,
 	std::string eventName) {
 	KeyPressParams* keyPressData = (KeyPressParams*)params;
-	if (keyPressData->Key.Index == PGUP_KEY) {
-		cvarManager->log("Player requested opening Nvidia summary.");
-		g_highlights.OnOpenSummary(&std::vector<char const*>({ GROUP1_ID })[0], 1,
-			NVGSDK_HIGHLIGHT_SIGNIFICANCE_NONE,
-			NVGSDK_HIGHLIGHT_TYPE_NONE);
-	}
-	if (keyPressData->Key.Index == PGDN_KEY) {
-		cvarManager->log("Player requested custom recording.");
-		OnRecordingTrigger(
-			"PlayerEvent",
-			g_highlightsConfig.highlightsData["PlayerEvent"].startDelta,
-			g_highlightsConfig.highlightsData["PlayerEvent"].endDelta);
-	}
-	if (keyPressData->Key.Index == END_KEY) {
-		cvarManager->log("Player requested clearing highlights.");
-		g_highlights.OnCloseGroup(GROUP1_ID, true);
-		g_highlights.OnOpenGroup(GROUP1_ID);
-	}
+	if (keyPressData->Key.Index == PGUP_KEY)
+		g_core.OnHotKey(HotKey::OpenSummary);
+	if (keyPressData->Key.Index == PGDN_KEY)
+		g_core.OnHotKey(HotKey::PlayerEvent);
+	if (keyPressData->Key.Index == END_KEY)
+		g_core.OnHotKey(HotKey::ClearHighlights);
 }
 
 
 void Bakelite::OnMatchEnter() {
-	// Don't close group if user doesn't open summary page or they will lose their recordings.
-	if (*bClearHighlightsOnNewMatch)
-		g_highlights.OnCloseGroup(GROUP1_ID, true);
-	cvarManager->log("Player entered match, creating Highlights group.");
-	g_highlights.OnOpenGroup(GROUP1_ID);
+	localPri = 0;
+	localTeam = -1;
+	g_core.SetLocalPlayer(0);
+	g_core.OnMatchEnter(*bClearHighlightsOnNewMatch);
 }
 
 void Bakelite::OnMatchExit() {
-	if (!(*bShowSummaryOnExit))
-		return;
-	cvarManager->log("Player exited, opening Nvidia summary.");
-	g_highlights.OnOpenSummary(&std::vector<char const*>({ GROUP1_ID })[0], 1,
-		NVGSDK_HIGHLIGHT_SIGNIFICANCE_NONE,
-		NVGSDK_HIGHLIGHT_TYPE_NONE);
+	g_core.OnMatchExit(*bShowSummaryOnExit);
 }
 
-void Bakelite::OnRecordingTrigger(std::string name,
-	int startDelta,
-	int endDelta) {
-	if (!(*bEnabled))
+// The PRI is recreated every match and may not exist yet when it starts, so it
+// is looked up on stat events until found
+void Bakelite::ResolveLocalPlayer() {
+	PlayerControllerWrapper controller = gameWrapper->GetPlayerController();
+	if (controller.IsNull())
 		return;
-
-	// If receiving same events multiple times in a short interval, check if enough time passed.
-	std::chrono::duration<double> elapsed_seconds =
-		std::chrono::system_clock::now() -
-		g_highlightsConfig.highlightsData[name].lastCapture;
-	if (elapsed_seconds.count() < *fDelay) {
+	PriWrapper pri = controller.GetPRI();
+	if (pri.IsNull())
 		return;
-	}
-	ostringstream os;
-	os << "Received event: " << name << " - Will record [" << startDelta << "ms/+"
-		<< endDelta << "ms]";
-	cvarManager->log(os.str());
-
-	g_highlights.OnSaveVideo(name.c_str(), GROUP1_ID, startDelta, endDelta);
-	g_highlightsConfig.highlightsData[name].lastCapture =
-		std::chrono::system_clock::now();
+	localPri = pri.memory_address;
+	localTeam = pri.GetTeamNum();
+	g_core.SetLocalPlayer(localPri);
 }
 
 void Bakelite::OnStatEvent(ServerWrapper caller, void* args) {
 	auto tArgs = (StatEventStruct*)args;
+	if (localPri == 0)
+		ResolveLocalPlayer();
+	g_core.HandleStatEvent(tArgs->StatEvent, tArgs->PRI);
+}
 
-	auto statEvent = StatEventWrapper(tArgs->StatEvent);
-	std::string eventString = statEvent.GetEventName();
-	if (g_highlightsConfig.highlightsData.find(eventString) !=
-		g_highlightsConfig.highlightsData.end()) {
-		cvarManager->log("Found config for event of type: " + eventString);
-		OnRecordingTrigger(
-			eventString, g_highlightsConfig.highlightsData[eventString].startDelta,
-			g_highlightsConfig.highlightsData[eventString].endDelta);
+void Bakelite::OnGameTimeUpdated(ServerWrapper caller) {
+	if (caller.IsNull())
+		return;
+	g_core.SetGameClock(caller.GetSecondsRemaining(), caller.GetbOverTime());
+}
+
+// Every goal is followed by a kickoff, so the margin a goal is scored at is
+// the one of the kickoff before it
+void Bakelite::OnKickoff(ServerWrapper caller) {
+	if (localPri == 0)
+		ResolveLocalPlayer();
+	if (caller.IsNull() || localTeam < 0) {
+		g_core.ClearScoreMargin();
+		return;
+	}
+	ArrayWrapper<TeamWrapper> teams = caller.GetTeams();
+	if (teams.Count() != 2) {
+		g_core.ClearScoreMargin();
+		return;
 	}
-	else {
-		cvarManager->log("Could not find config for event of type: " + eventString);
+	int margin = 0;
+	for (int i = 0; i < teams.Count(); i++) {
+		TeamWrapper team = teams.Get(i);
+		margin += team.GetTeamNum() == localTeam ? team.GetScore() : -team.GetScore();
 	}
+	g_core.SetScoreMargin(margin);
 }
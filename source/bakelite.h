@@ -14,20 +14,24 @@ struct StatEventStruct {
 
 class Bakelite : public BakkesMod::Plugin::BakkesModPlugin {
  private:
-  std::shared_ptr<bool> bEnabled;
   std::shared_ptr<bool> bShowSummaryOnExit;
   std::shared_ptr<bool> bClearHighlightsOnNewMatch;
-  std::shared_ptr<float> fDelay;
-  // delay between 2 recordings of same event
+  // Time onLoad held the game thread
+  double loadBlockedUs = 0.0;
+  // Local player of the current match, resolved on its first stat event
+  uintptr_t localPri = 0;
+  int localTeam = -1;
 
  public:
   void onLoad() override;
   void onUnload() override;
   void OnMatchEnter();
   void OnMatchExit();
-  void LoadHighlightConfig();
-  void LoadGfeSDK();
+  void ApplyPollIntervals();
+  void ApplyRateLimits();
   void OnKeyPressed(ActorWrapper aw, void* params, std::string eventName);
   void OnStatEvent(ServerWrapper caller, void* args);
-  void OnRecordingTrigger(std::string name, int startDelta, int endDelta);
+  void ResolveLocalPlayer();
+  void OnGameTimeUpdated(ServerWrapper caller);
+  void OnKickoff(ServerWrapper caller);
 };
\ No newline at end of file
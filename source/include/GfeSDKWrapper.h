@@ -17,130 +17,193 @@ extern "C" {
 #include <gfesdk/isdk.h>
 // Core
 
-typedef NVGSDK_RetCode(__cdecl* NVGSDK_Createfn)(
+typedef NVGSDK_RetCode(NVGSDKApi* NVGSDK_Createfn)(
     NVGSDK_HANDLE**,
     NVGSDK_CreateInputParams const*,
     NVGSDK_CreateResponse*);
 
-typedef NVGSDK_RetCode(__cdecl* NVGSDK_Releasefn)(NVGSDK_HANDLE*);
-typedef NVGSDK_RetCode(__cdecl* NVGSDK_Pollfn)(NVGSDK_HANDLE*);
-typedef NVGSDK_RetCode(__cdecl* NVGSDK_SetLogLevelfn)(NVGSDK_LogLevel);
-typedef NVGSDK_RetCode(__cdecl* NVGSDK_AttachLogListenerfn)(
+typedef NVGSDK_RetCode(NVGSDKApi* NVGSDK_Releasefn)(NVGSDK_HANDLE*);
+typedef NVGSDK_RetCode(NVGSDKApi* NVGSDK_Pollfn)(NVGSDK_HANDLE*);
+typedef NVGSDK_RetCode(NVGSDKApi* NVGSDK_SetLogLevelfn)(NVGSDK_LogLevel);
+typedef NVGSDK_RetCode(NVGSDKApi* NVGSDK_AttachLogListenerfn)(
     NVGSDK_LoggingCallback);
 
-typedef NVGSDK_RetCode(__cdecl* NVGSDK_SetListenerLogLevelfn)(
+typedef NVGSDK_RetCode(NVGSDKApi* NVGSDK_SetListenerLogLevelfn)(
     NVGSDK_LogLevel);
-typedef void(__cdecl* NVGSDK_RequestPermissionsAsyncfn)(
+typedef void(NVGSDKApi* NVGSDK_RequestPermissionsAsyncfn)(
     NVGSDK_HANDLE*,
     NVGSDK_RequestPermissionsParams const*,
     NVGSDK_EmptyCallback,
     void*);
-typedef void(__cdecl* NVGSDK_GetUILanguageAsyncfn)(
+typedef void(NVGSDKApi* NVGSDK_GetUILanguageAsyncfn)(
     NVGSDK_HANDLE*,
     NVGSDK_GetUILanguageCallback,
     void*);
 
 // Highlights
-typedef void(__cdecl* NVGSDK_Highlights_ConfigureAsyncfn)(
+typedef void(NVGSDKApi* NVGSDK_Highlights_ConfigureAsyncfn)(
     NVGSDK_HANDLE*,
     NVGSDK_HighlightConfigParams const*,
     NVGSDK_EmptyCallback,
     void*);
 
-typedef void(__cdecl* NVGSDK_Highlights_GetUserSettingsAsyncfn)(
+typedef void(NVGSDKApi* NVGSDK_Highlights_GetUserSettingsAsyncfn)(
     NVGSDK_HANDLE*,
     NVGSDK_Highlights_GetUserSettingsCallback,
     void*);
 
-typedef void(__cdecl* NVGSDK_Highlights_OpenGroupAsyncfn)(
+typedef void(NVGSDKApi* NVGSDK_Highlights_OpenGroupAsyncfn)(
     NVGSDK_HANDLE*,
     NVGSDK_HighlightOpenGroupParams const*,
     NVGSDK_EmptyCallback,
     void*);
 
-typedef void(__cdecl* NVGSDK_Highlights_CloseGroupAsyncfn)(
+typedef void(NVGSDKApi* NVGSDK_Highlights_CloseGroupAsyncfn)(
     NVGSDK_HANDLE*,
     NVGSDK_HighlightCloseGroupParams const*,
     NVGSDK_EmptyCallback,
     void*);
 
-typedef void(__cdecl* NVGSDK_Highlights_SetScreenshotHighlightAsyncfn)(
+typedef void(NVGSDKApi* NVGSDK_Highlights_SetScreenshotHighlightAsyncfn)(
     NVGSDK_HANDLE*,
     NVGSDK_ScreenshotHighlightParams const*,
     NVGSDK_EmptyCallback,
     void*);
 
-typedef void(__cdecl* NVGSDK_Highlights_SetVideoHighlightAsyncfn)(
+typedef void(NVGSDKApi* NVGSDK_Highlights_SetVideoHighlightAsyncfn)(
     NVGSDK_HANDLE*,
     NVGSDK_VideoHighlightParams const*,
     NVGSDK_EmptyCallback,
     void*);
 
-typedef void(__cdecl* NVGSDK_Highlights_OpenSummaryAsyncfn)(
+typedef void(NVGSDKApi* NVGSDK_Highlights_OpenSummaryAsyncfn)(
     NVGSDK_HANDLE*,
     NVGSDK_SummaryParams const*,
     NVGSDK_EmptyCallback,
     void*);
 
-typedef void(__cdecl* NVGSDK_Highlights_GetNumberOfHighlightsAsyncfn)(
+typedef void(NVGSDKApi* NVGSDK_Highlights_GetNumberOfHighlightsAsyncfn)(
     NVGSDK_HANDLE*,
     NVGSDK_GroupView const*,
     NVGSDK_Highlights_GetNumberOfHighlightsCallback,
     void*);
 
-NVGSDK_Createfn NVGSDK_Create;
-NVGSDK_Releasefn NVGSDK_Release;
-NVGSDK_Pollfn NVGSDK_Poll;
-NVGSDK_SetLogLevelfn NVGSDK_SetLogLevel;
-NVGSDK_AttachLogListenerfn NVGSDK_AttachLogListener;
-NVGSDK_SetListenerLogLevelfn NVGSDK_SetListenerLogLevel;
-NVGSDK_RequestPermissionsAsyncfn NVGSDK_RequestPermissionsAsync;
-NVGSDK_GetUILanguageAsyncfn NVGSDK_GetUILanguageAsync;
-NVGSDK_Highlights_ConfigureAsyncfn NVGSDK_Highlights_ConfigureAsync;
-
-NVGSDK_Highlights_GetUserSettingsAsyncfn NVGSDK_Highlights_GetUserSettingsAsync;
-NVGSDK_Highlights_OpenGroupAsyncfn NVGSDK_Highlights_OpenGroupAsync;
-NVGSDK_Highlights_CloseGroupAsyncfn NVGSDK_Highlights_CloseGroupAsync;
-NVGSDK_Highlights_SetScreenshotHighlightAsyncfn
+// Bound by the host before Init, to GfeSDK.dll or to a fake backend, defined
+// in GfeSDKWrapper.c
+extern NVGSDK_Createfn NVGSDK_Create;
+extern NVGSDK_Releasefn NVGSDK_Release;
+extern NVGSDK_Pollfn NVGSDK_Poll;
+extern NVGSDK_SetLogLevelfn NVGSDK_SetLogLevel;
+extern NVGSDK_AttachLogListenerfn NVGSDK_AttachLogListener;
+extern NVGSDK_SetListenerLogLevelfn NVGSDK_SetListenerLogLevel;
+extern NVGSDK_RequestPermissionsAsyncfn NVGSDK_RequestPermissionsAsync;
+extern NVGSDK_GetUILanguageAsyncfn NVGSDK_GetUILanguageAsync;
+extern NVGSDK_Highlights_ConfigureAsyncfn NVGSDK_Highlights_ConfigureAsync;
+
+extern NVGSDK_Highlights_GetUserSettingsAsyncfn
+    NVGSDK_Highlights_GetUserSettingsAsync;
+extern NVGSDK_Highlights_OpenGroupAsyncfn NVGSDK_Highlights_OpenGroupAsync;
+extern NVGSDK_Highlights_CloseGroupAsyncfn NVGSDK_Highlights_CloseGroupAsync;
+extern NVGSDK_Highlights_SetScreenshotHighlightAsyncfn
     NVGSDK_Highlights_SetScreenshotHighlightAsync;
-NVGSDK_Highlights_SetVideoHighlightAsyncfn
+extern NVGSDK_Highlights_SetVideoHighlightAsyncfn
     NVGSDK_Highlights_SetVideoHighlightAsync;
-NVGSDK_Highlights_OpenSummaryAsyncfn NVGSDK_Highlights_OpenSummaryAsync;
-NVGSDK_Highlights_GetNumberOfHighlightsAsyncfn
+extern NVGSDK_Highlights_OpenSummaryAsyncfn NVGSDK_Highlights_OpenSummaryAsync;
+extern NVGSDK_Highlights_GetNumberOfHighlightsAsyncfn
     NVGSDK_Highlights_GetNumberOfHighlightsAsync;
 
+// One SDK handle and everything tracking its calls: request table, context
+// pool and status. Sessions share nothing but the bound NVGSDK_* functions, so
+// several can run on their own threads.
+typedef struct GfeSdkSession GfeSdkSession;
+struct SdkRequestTable;
+struct SdkContextPool;
+struct SdkStatusCell;
+struct SdkBatch;
+
+// Result of a call returning a request id, on the thread polling the session.
+// Ids are never 0, the calls return 0 when the session has no handle.
+typedef void (*GfeSdkCompletionHandler)(void* context,
+                                        uint64_t requestId,
+                                        NVGSDK_RetCode rc);
+
+// One entry of OnSaveVideoBatch
+typedef struct {
+  char const* highlightId;
+  char const* groupId;
+  int startDelta;
+  int endDelta;
+} GfeSdkVideoHighlight;
+
 typedef struct _GfeSdkWrapper {
-  void (*Init)(char const* gameName,
-               char const* defaultLocale,
-               NVGSDK_Highlight* highlights,
-               size_t numHighlights,
-               char const* targetPath,
-               int targetPid);
-  void (*DeInit)();
-  void (*OnTick)();
-  void (*OnOpenGroup)(char const* groupId);
-  void (*OnCloseGroup)(char const* groupId, bool destroy);
-  void (*OnSaveScreenshot)(char const* highlightId, char const* groupId);
-  void (*OnSaveVideo)(char const* highlightId,
-                      char const* groupId,
-                      int startDelta,
-                      int endDelta);
-  void (*OnGetNumHighlights)(char const* groupId, int sigFilter, int tagFilter);
-  void (*OnOpenSummary)(char const* groupIds[],
+  // Never NULL; when the SDK is not bound or Create fails the session has no
+  // handle and the On* calls are rejected
+  GfeSdkSession* (*Init)(char const* gameName,
+                         char const* defaultLocale,
+                         NVGSDK_Highlight* highlights,
+                         size_t numHighlights,
+                         char const* targetPath,
+                         int targetPid);
+  // Releases the handle. The session's stats stay readable until
+  // DestroySession, which must come after the last callback.
+  void (*DeInit)(GfeSdkSession* session);
+  void (*DestroySession)(GfeSdkSession* session);
+  // Reports the result of every OpenGroup, CloseGroup, SaveScreenshot and
+  // SaveVideo call, e.g. to retry the failed ones. NULL turns it off.
+  void (*SetCompletionHandler)(GfeSdkSession* session,
+                               GfeSdkCompletionHandler handler,
+                               void* context);
+  // Submits a copy of the highlight table. Init already does this once
+  // recording is permitted.
+  void (*ConfigureHighlights)(GfeSdkSession* session,
+                              char const* defaultLocale,
+                              NVGSDK_Highlight* highlights,
+                              size_t numHighlights);
+  void (*OnTick)(GfeSdkSession* session);
+  uint64_t (*OnOpenGroup)(GfeSdkSession* session, char const* groupId);
+  uint64_t (*OnCloseGroup)(GfeSdkSession* session,
+                           char const* groupId,
+                           bool destroy);
+  uint64_t (*OnSaveScreenshot)(GfeSdkSession* session,
+                               char const* highlightId,
+                               char const* groupId);
+  uint64_t (*OnSaveVideo)(GfeSdkSession* session,
+                          char const* highlightId,
+                          char const* groupId,
+                          int startDelta,
+                          int endDelta);
+  // Submits every video back to back and tracks them with one batch, see
+  // SdkBatch.h. The caller owns a reference and calls SdkBatchRelease. When
+  // the session has no handle the batch comes back done with every item
+  // failed.
+  struct SdkBatch* (*OnSaveVideoBatch)(GfeSdkSession* session,
+                                       GfeSdkVideoHighlight const* videos,
+                                       size_t count);
+  void (*OnGetNumHighlights)(GfeSdkSession* session,
+                             char const* groupId,
+                             int sigFilter,
+                             int tagFilter);
+  void (*OnOpenSummary)(GfeSdkSession* session,
+                        char const* groupIds[],
                         size_t numGroups,
                         int sigFilter,
                         int tagFiler);
-  void (*OnRequestLanguage)();
-  void (*OnRequestUserSettings)();
-
-  wchar_t const* (*GetCurrentPermissionStr)();
-  wchar_t const* (*GetLastOverlayEvent)();
-  wchar_t const* (*GetLastResult)();
-  wchar_t const* (*GetLastQueryResult)();
+  void (*OnRequestLanguage)(GfeSdkSession* session);
+  void (*OnRequestUserSettings)(GfeSdkSession* session);
 } GfeSdkWrapper;
 
 void InitGfeSdkWrapper(GfeSdkWrapper* hl);
 
+// False when the SDK was not bound, Create failed or the session was DeInit
+bool GfeSdkSessionOpen(GfeSdkSession const* session);
+// SdkReadiness of the session, see SdkStatus.h. On the thread polling the
+// session; other threads read it from the status.
+int GfeSdkSessionReadiness(GfeSdkSession const* session);
+
+struct SdkRequestTable* GfeSdkSessionRequests(GfeSdkSession const* session);
+struct SdkContextPool* GfeSdkSessionContexts(GfeSdkSession const* session);
+struct SdkStatusCell* GfeSdkSessionStatus(GfeSdkSession const* session);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,17 @@ extern "C" {
 
 #   define NVGSDKApi __cdecl
 #   define NVGSDK_INTERFACE struct __declspec(novtable)
+#elif defined __GNUC__
+// Non-Windows builds only ever talk to an in-process backend (see FakeGfeSdk.h)
+#   define NVGSDK_EXPORT __attribute__((visibility("default")))
+#   define NVGSDKApi
+#   define NVGSDK_INTERFACE struct
+#   ifndef __stdcall
+#       define __stdcall
+#   endif
+#   ifndef __cdecl
+#       define __cdecl
+#   endif
 #else
 #error Add the appropriate construct for the platform complier
 #endif